@@ -0,0 +1,265 @@
+// Compares the slot storages of mlc::dense_list on a list with millions of slots.
+//
+// The list is filled with push_back, then its link order is scrambled by moving
+// random values to the back, so that traversal jumps around the slot array the way a
+// long lived list does. The traversal is where huge pages pay off: every hop is a
+// likely TLB miss with 4 KiB pages.
+//
+// A second run pages through a smaller list by position, with and without the order
+// statistics index, and then uses both as a FIFO queue.
+//
+// A third run publishes copies of a list the way a writer hands snapshots to readers:
+// a copy per value, clone(), and a copy-on-write snapshot followed by a batch of edits
+// that has to unshare the chunks it touches.
+//
+// The last run compares slot layouts on records with a small hot key and a larger
+// cold body, scanning the keys in scrambled link order, and reports the bytes each
+// element takes.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "dense_list.hpp"
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct payload {
+
+        std::uint64_t key;
+        std::uint64_t value;
+    };
+
+    double ns_per_op(clock_type::time_point start, std::size_t ops)
+    {
+        const auto elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start);
+        return elapsed.count() / static_cast<double>(ops);
+    }
+
+    template<typename List>
+    void run(const char* name, List list, std::size_t count)
+    {
+        std::mt19937_64 rng(42);
+
+        auto start = clock_type::now();
+        std::vector<typename List::index_type> handles(count);
+        for (std::size_t i = 0; i < count; ++i)
+            handles[i] = list.push_back(payload{i, i});
+        const double fill = ns_per_op(start, count);
+
+        std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+
+            auto& handle = handles[pick(rng)];
+            const payload value = list.get(handle);
+            list.remove(handle);
+            handle = list.push_back(value);
+        }
+
+        start = clock_type::now();
+        std::uint64_t sum = 0;
+        for (const auto& value : list)
+            sum += value.key;
+        const double traverse = ns_per_op(start, count);
+
+        std::printf("%-16s push_back %6.2f ns  traverse %6.2f ns  (checksum %llu)\n", name, fill, traverse, static_cast<unsigned long long>(sum));
+    }
+
+    template<typename List>
+    void page(const char* name, std::size_t count, std::size_t lookups)
+    {
+        List list;
+        for (std::size_t i = 0; i < count; ++i)
+            list.push_back(payload{i, i});
+
+        // An edit in the middle moves everything into the treap, like a long lived list
+        list.insert(static_cast<std::uint32_t>(count / 2), payload{count, count});
+
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(count - 1));
+
+        const auto start = clock_type::now();
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < lookups; ++i)
+            sum += list[pick(rng)].key;
+        const double lookup = ns_per_op(start, lookups);
+
+        std::printf("%-16s operator[] %10.2f ns  (checksum %llu)\n", name, lookup, static_cast<unsigned long long>(sum));
+    }
+
+    template<typename List>
+    void queue(const char* name, std::size_t count, std::size_t ops)
+    {
+        List list;
+        for (std::size_t i = 0; i < count; ++i)
+            list.push_back(payload{i, i});
+
+        const auto start = clock_type::now();
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < ops; ++i) {
+
+            list.push_back(payload{i, i});
+            sum += list.front().key;
+            list.pop_front();
+        }
+        const double pair = ns_per_op(start, ops);
+
+        std::printf("%-16s push_back + pop_front %6.2f ns  (checksum %llu)\n", name, pair, static_cast<unsigned long long>(sum));
+    }
+
+    template<typename List>
+    List fill(std::size_t count)
+    {
+        List list;
+        for (std::size_t i = 0; i < count; ++i)
+            list.push_back(payload{i, i});
+        return list;
+    }
+
+    double us_since(clock_type::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+    }
+
+    void publish(std::size_t count, std::size_t edits)
+    {
+        using vector_list = mlc::dense_list<payload>;
+        using cow_list = mlc::dense_list<payload, mlc::cow_storage<mlc::dense_list_slot<payload>>>;
+
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+
+        vector_list source = fill<vector_list>(count);
+        std::vector<vector_list::index_type> handles;
+        for (auto it = source.begin(); it != source.end(); ++it)
+            handles.push_back(it.handle());
+
+        auto start = clock_type::now();
+        vector_list copy;
+        for (const auto& value : source)
+            copy.push_back(value);
+        std::printf("%-16s %10.1f us\n", "per value copy", us_since(start));
+
+        start = clock_type::now();
+        vector_list cloned = source.clone();
+        std::printf("%-16s %10.1f us\n", "clone()", us_since(start));
+
+        cow_list writer = fill<cow_list>(count);
+
+        start = clock_type::now();
+        auto snapshot = writer.snapshot();
+        const double take = us_since(start);
+
+        start = clock_type::now();
+        for (std::size_t i = 0; i < edits; ++i)
+            writer.edit(handles[pick(rng)]).value = i;
+        std::printf("%-16s %10.1f us  + %zu edits %10.1f us\n", "snapshot()", take, edits, us_since(start));
+
+        if (copy.size() + cloned.size() + snapshot->size() != 3 * count) std::printf("size mismatch\n");
+    }
+
+    struct record_body {
+
+        char bytes[60];
+    };
+
+    struct record {
+
+        std::uint32_t key;
+        record_body body;
+    };
+
+    std::uint32_t key_of(const record& value) { return value.key; }
+    std::uint32_t key_of(std::uint32_t value) { return value; }
+    std::uint32_t key_of(const payload& value) { return static_cast<std::uint32_t>(value.key); }
+
+    template<typename List, typename Make>
+    void scan(const char* name, std::size_t count, Make&& make, std::size_t bytes_per_element)
+    {
+        List list;
+        std::vector<typename List::index_type> handles(count);
+        for (std::size_t i = 0; i < count; ++i)
+            handles[i] = list.push_back(make(i));
+
+        std::mt19937_64 rng(7);
+        std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+
+            auto& handle = handles[pick(rng)];
+            const auto value = list.get(handle);
+            list.remove(handle);
+            handle = list.push_back(value);
+        }
+
+        const auto start = clock_type::now();
+        std::uint64_t matches = 0;
+        for (const auto& value : list)
+            matches += key_of(value) % 7 == 0;
+        const double traverse = ns_per_op(start, count);
+
+        std::printf("%-22s %4zu bytes/element  scan %6.2f ns  (matches %llu)\n", name, bytes_per_element, traverse, static_cast<unsigned long long>(matches));
+    }
+
+    void layouts(std::size_t count)
+    {
+        using packed_record = mlc::dense_list_slot<record>;
+        using aligned_record = mlc::cache_line_layout<>::slot<record>;
+        using split_key = mlc::hot_cold_layout<record_body>::slot<std::uint32_t>;
+        using split_aligned_key = mlc::hot_cold_layout<record_body, mlc::cache_line_layout<>>::slot<std::uint32_t>;
+        using packed_payload = mlc::dense_list_slot<payload>;
+        using aligned_payload = mlc::cache_line_layout<>::slot<payload>;
+
+        const auto make_record = [](std::size_t i) { return record{static_cast<std::uint32_t>(i), {}}; };
+        const auto make_key = [](std::size_t i) { return static_cast<std::uint32_t>(i); };
+        const auto make_payload = [](std::size_t i) { return payload{i, i}; };
+
+        scan<mlc::dense_list<record, mlc::vector_storage<packed_record>>>("record packed", count, make_record, sizeof(packed_record));
+        scan<mlc::dense_list<record, mlc::vector_storage<aligned_record>>>("record cache line", count, make_record, sizeof(aligned_record));
+        scan<mlc::dense_list<std::uint32_t, mlc::vector_storage<split_key>>>("record hot/cold", count, make_key, sizeof(split_key) + sizeof(record_body));
+        scan<mlc::dense_list<std::uint32_t, mlc::vector_storage<split_aligned_key>>>("record hot/cold line", count, make_key, sizeof(split_aligned_key) + sizeof(record_body));
+        scan<mlc::dense_list<payload, mlc::vector_storage<packed_payload>>>("payload packed", count, make_payload, sizeof(packed_payload));
+        scan<mlc::dense_list<payload, mlc::vector_storage<aligned_payload>>>("payload cache line", count, make_payload, sizeof(aligned_payload));
+    }
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4'000'000;
+
+    using vector_list = mlc::dense_list<payload>;
+    using mapped_list = mlc::dense_list<payload, mlc::mapped_storage<mlc::dense_list_slot<payload>>>;
+
+    mlc::mapped_storage_options small_pages;
+    small_pages.huge_pages = false;
+
+    mlc::mapped_storage<mlc::dense_list_slot<payload>> huge_storage;
+    std::printf("%zu slots, transparent huge pages %s\n", count, huge_storage.huge_pages() ? "granted" : "unavailable");
+
+    run("vector_storage", vector_list{}, count);
+    run("mapped 4k", mapped_list{mlc::mapped_storage<mlc::dense_list_slot<payload>>(small_pages)}, count);
+    run("mapped huge", mapped_list{std::move(huge_storage)}, count);
+
+    using indexed_list = mlc::dense_list<payload, mlc::vector_storage<mlc::dense_list_slot<payload>>, mlc::order_statistics_index>;
+
+    std::printf("random positions in %zu values\n", count / 16);
+    page<vector_list>("walk", count / 16, 2'000);
+    page<indexed_list>("indexed", count / 16, 2'000'000);
+
+    std::printf("FIFO over %zu values\n", count / 4);
+    queue<vector_list>("unindexed", count / 4, 10'000'000);
+    queue<indexed_list>("indexed", count / 4, 10'000'000);
+
+    std::printf("publishing a copy of %zu values\n", count);
+    publish(count, 1'000);
+
+    std::printf("slot layouts, %zu elements\n", count);
+    layouts(count);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Measures insert/erase throughput on a shared slot pool from 1 to 64 threads.
+//
+// The first run has every thread keep a small window of live slots and replace the
+// oldest one on each step. That stays inside the thread's own two magazines, so it
+// measures the cache alone. In the second run every thread takes a burst of slots larger
+// than two magazines and then gives them all back, so magazines keep moving through the
+// depot and its lock shows up in the numbers. The baseline takes a single mutex around
+// one free list, which is what the pool looks like without its per-thread magazines.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dense_slot_pool.hpp"
+
+namespace {
+
+    using index_type = std::uint32_t;
+
+    constexpr std::size_t window = 32;
+    constexpr std::size_t burst = 256;
+    constexpr std::size_t max_threads = 64;
+
+    struct payload {
+
+        std::uint64_t key;
+        std::uint64_t value;
+    };
+
+    class locked_pool {
+
+        public:
+
+            explicit locked_pool(std::size_t capacity)
+                : slots(capacity) {
+
+                for (std::size_t index = capacity; index-- > 0;)
+                    free.push_back(static_cast<index_type>(index));
+            }
+
+            index_type insert(std::uint64_t key) {
+
+                std::lock_guard guard(lock);
+                const index_type index = free.back();
+                free.pop_back();
+                slots[index] = {key, key};
+                return index;
+            }
+
+            void erase(index_type index) {
+
+                std::lock_guard guard(lock);
+                free.push_back(index);
+            }
+
+        private:
+
+            std::mutex lock;
+            std::vector<index_type> free;
+            std::vector<payload> slots;
+    };
+
+    template<typename Body>
+    double run(std::size_t threads, std::size_t pairs, Body&& body)
+    {
+        std::atomic<std::size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.emplace_back([&] {
+
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                body(pairs);
+            });
+
+        while (ready.load() != threads) std::this_thread::yield();
+
+        const auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers) worker.join();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        return static_cast<double>(threads * pairs) / elapsed.count() / 1e6;
+    }
+
+    template<typename Insert, typename Erase>
+    void rolling(std::size_t pairs, Insert&& insert, Erase&& erase)
+    {
+        index_type live[window];
+        for (std::size_t i = 0; i < window; ++i) live[i] = insert(i);
+        for (std::size_t i = 0; i < pairs; ++i) {
+
+            erase(live[i % window]);
+            live[i % window] = insert(i);
+        }
+        for (std::size_t i = 0; i < window; ++i) erase(live[i]);
+    }
+
+    template<typename Insert, typename Erase>
+    void bursts(std::size_t pairs, Insert&& insert, Erase&& erase)
+    {
+        index_type live[burst];
+        for (std::size_t done = 0; done < pairs; done += burst) {
+
+            for (std::size_t i = 0; i < burst; ++i) live[i] = insert(done + i);
+            for (std::size_t i = 0; i < burst; ++i) erase(live[i]);
+        }
+    }
+
+    template<typename Workload>
+    void table(const char* title, std::size_t pairs, std::size_t capacity, Workload&& workload)
+    {
+        std::printf("%s\n", title);
+        std::printf("%8s %20s %20s\n", "threads", "locked Mpairs/s", "magazine Mpairs/s");
+
+        for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+
+            locked_pool baseline(capacity);
+            const double locked = run(threads, pairs, [&](std::size_t count) {
+
+                workload(count, [&](std::uint64_t key) { return baseline.insert(key); }, [&](index_type index) { baseline.erase(index); });
+            });
+
+            mlc::dense_slot_pool<payload> pool(capacity);
+            const double magazine = run(threads, pairs, [&](std::size_t count) {
+
+                mlc::dense_slot_pool<payload>::thread_cache cache(pool);
+                workload(count, [&](std::uint64_t key) { return cache.insert(payload{key, key}); }, [&](index_type index) { cache.erase(index); });
+            });
+
+            std::printf("%8zu %20.2f %20.2f\n", threads, locked, magazine);
+        }
+    }
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t pairs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const std::size_t capacity = max_threads * (burst + 2 * mlc::slot_magazine::capacity);
+
+    std::printf("insert/erase pairs per thread: %zu, hardware threads: %u\n", pairs, std::thread::hardware_concurrency());
+
+    table("rolling window of 32, inside the thread caches", pairs, capacity, [](std::size_t count, auto&& insert, auto&& erase) { rolling(count, insert, erase); });
+    table("bursts of 256, through the depot", pairs, capacity, [](std::size_t count, auto&& insert, auto&& erase) { bursts(count, insert, erase); });
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Compares mcl::timer_wheel against a std::priority_queue based timer set.
+//
+// Both hold the same number of active timers with random expiries, then go through
+// three phases: arming every timer, re-arming a random timer (cancel + schedule), and
+// running time forward until every timer has fired. The priority queue cancels lazily
+// by bumping a per-timer generation, which is how heap based timer sets usually avoid
+// an O(n) search.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+namespace {
+
+    using tick_type = std::uint64_t;
+
+    struct wheel_timer : public mcl::timer_wheel_node<wheel_timer> {
+
+        std::uint32_t id = 0;
+    };
+
+    struct heap_entry {
+
+        tick_type expiry;
+        std::uint32_t id;
+        std::uint32_t generation;
+
+        bool operator>(const heap_entry& other) const { return expiry > other.expiry; }
+    };
+
+    class heap_timers {
+
+        public:
+
+            explicit heap_timers(std::size_t count)
+                : generation(count, 0) {}
+
+            void schedule(std::uint32_t id, tick_type expiry)
+            {
+                queue.push({expiry, id, ++generation[id]});
+            }
+
+            void cancel(std::uint32_t id)
+            {
+                ++generation[id];
+            }
+
+            template<typename Callback>
+            std::size_t advance_to(tick_type target, Callback&& on_expire)
+            {
+                std::size_t fired = 0;
+
+                while (!queue.empty() && queue.top().expiry <= target) {
+
+                    const heap_entry entry = queue.top();
+                    queue.pop();
+                    if (entry.generation != generation[entry.id])
+                        continue;
+
+                    ++fired;
+                    on_expire(entry.id);
+                }
+
+                return fired;
+            }
+
+        private:
+
+            std::priority_queue<heap_entry, std::vector<heap_entry>, std::greater<heap_entry>> queue;
+            std::vector<std::uint32_t> generation;
+    };
+
+    using clock_type = std::chrono::steady_clock;
+
+    double ns_per_op(clock_type::time_point start, std::size_t ops)
+    {
+        const auto elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start);
+        return elapsed.count() / static_cast<double>(ops);
+    }
+
+    void report(const char* name, double schedule, double rearm, double expire)
+    {
+        std::printf("%-20s schedule %8.2f ns  rearm %8.2f ns  expire %8.2f ns\n", name, schedule, rearm, expire);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const tick_type horizon = tick_type{1} << 20;
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<tick_type> delay(1, horizon);
+    std::uniform_int_distribution<std::uint32_t> pick(0, static_cast<std::uint32_t>(count - 1));
+
+    std::vector<tick_type> expiries(count);
+    for (auto& expiry : expiries)
+        expiry = delay(rng);
+
+    std::vector<std::pair<std::uint32_t, tick_type>> rearms(count);
+    for (auto& rearm : rearms)
+        rearm = {pick(rng), delay(rng)};
+
+    std::printf("%zu active timers over %llu ticks\n", count, static_cast<unsigned long long>(horizon));
+
+    {
+        std::vector<wheel_timer> timers(count);
+        mcl::timer_wheel<wheel_timer> wheel;
+        std::size_t fired = 0;
+
+        auto start = clock_type::now();
+        for (std::uint32_t i = 0; i < count; ++i) {
+
+            timers[i].id = i;
+            wheel.schedule(timers[i], expiries[i]);
+        }
+        const double schedule = ns_per_op(start, count);
+
+        start = clock_type::now();
+        for (const auto& [id, expiry] : rearms) {
+
+            wheel.cancel(timers[id]);
+            wheel.schedule(timers[id], expiry);
+        }
+        const double rearm = ns_per_op(start, count);
+
+        start = clock_type::now();
+        wheel.advance_to(horizon, [&](wheel_timer&) { ++fired; });
+        const double expire = ns_per_op(start, fired);
+
+        report("mcl::timer_wheel", schedule, rearm, expire);
+    }
+
+    {
+        heap_timers heap(count);
+        std::size_t fired = 0;
+
+        auto start = clock_type::now();
+        for (std::uint32_t i = 0; i < count; ++i)
+            heap.schedule(i, expiries[i]);
+        const double schedule = ns_per_op(start, count);
+
+        start = clock_type::now();
+        for (const auto& [id, expiry] : rearms) {
+
+            heap.cancel(id);
+            heap.schedule(id, expiry);
+        }
+        const double rearm = ns_per_op(start, count);
+
+        // Step tick by tick, like the wheel does, so both pay for the same clock resolution
+        start = clock_type::now();
+        for (tick_type now = 1; now <= horizon; ++now)
+            fired += heap.advance_to(now, [](std::uint32_t) {});
+        const double expire = ns_per_op(start, fired);
+
+        report("std::priority_queue", schedule, rearm, expire);
+    }
+
+    return 0;
+}
@@ -83,7 +83,7 @@ namespace mlc {
         
         protected:
 
-            inline static std::vector<std::shared_ptr<intrusive_dense_list_node<T>>> data;
+            std::vector<std::shared_ptr<intrusive_dense_list_node<T>>> data;
     };
 
     template<typename T>
@@ -148,7 +148,7 @@ namespace mlc {
             */
             void pop_back() {
 
-                if (!(this->data.empty())) this->data.erase(this->data.begin(), this->data.end() - 1);
+                if (!(this->data.empty())) this->data.pop_back();
                 return;
             }
 
@@ -198,7 +198,7 @@ namespace mlc {
             */
             void erase(uint32_t idx) {
 
-                if (!this->data.empty()) this->data.erase(this->data.begin() + idx, this->data.end());
+                if (idx < this->data.size()) this->data.erase(this->data.begin() + idx);
                 return;
             }
 
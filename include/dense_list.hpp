@@ -0,0 +1,642 @@
+// This file is part of the mcl project.
+// Copyright (c) 2022 merryhime
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "dense_storage.hpp"
+#include "order_statistics_index.hpp"
+
+namespace mlc {
+
+    /**
+     * One slot of a dense_list: the value and the indices of its neighbours. Slots that
+     * are not in use are chained through next into the list's free list.
+     */
+    template<typename T>
+    struct dense_list_slot {
+
+        using value_type = T;
+        using cold_type = void;
+        using index_type = std::uint32_t;
+
+        T lvalue{};
+        index_type next;
+        index_type prev;
+    };
+
+    /**
+     * Slot layout policies. A layout picks the slot type of a dense_list, which is then
+     * given to the storage: dense_list<T, vector_storage<cache_line_layout<>::slot<T>>>.
+     */
+
+    /**
+     * Slots are as small as the value and the links allow. The default.
+     */
+    struct packed_layout {
+
+        template<typename T>
+        using slot = dense_list_slot<T>;
+    };
+
+    /**
+     * Slots are padded so that none of them straddles a cache line: slots smaller than a
+     * line are rounded up to a power of two that divides it, larger ones to a multiple of
+     * the line. This trades some density for touching one line per hop; it pays off when
+     * the padding is small, e.g. a 12 or 28 byte slot, and costs the most when a slot is
+     * just over a power of two.
+     */
+    template<std::size_t LineBytes = 64>
+    struct cache_line_layout {
+
+        static_assert(std::has_single_bit(LineBytes));
+
+        template<typename T>
+        static constexpr std::size_t slot_alignment = sizeof(dense_list_slot<T>) <= LineBytes ? std::bit_ceil(sizeof(dense_list_slot<T>)) : LineBytes;
+
+        template<typename T>
+        struct alignas(slot_alignment<T>) slot : public dense_list_slot<T> {};
+    };
+
+    /**
+     * Slots hold only the hot part of each element, the value_type of the list, which is
+     * what traversal and comparisons look at. The cold remainder lives in a second array
+     * of the same storage kind, at the same index, and is reached with dense_list::cold.
+     *
+     * @tparam Cold The cold part of an element.
+     * @tparam Base The layout of the hot slots.
+     */
+    template<typename Cold, typename Base = packed_layout>
+    struct hot_cold_layout {
+
+        template<typename T>
+        struct slot : public Base::template slot<T> {
+
+            using cold_type = Cold;
+        };
+    };
+
+    namespace detail {
+
+        struct no_cold_storage {
+
+            void grow(std::size_t) {}
+            no_cold_storage clone() const { return {}; }
+            void swap(no_cold_storage&) noexcept {}
+        };
+
+        template<typename Storage, typename Cold>
+        struct cold_storage_for {
+
+            using type = typename Storage::template rebind<Cold>;
+
+            // The cold array is set up like the hot one
+            static type make(const Storage& hot) { return hot.template sibling<Cold>(); }
+        };
+
+        template<typename Storage>
+        struct cold_storage_for<Storage, void> {
+
+            using type = no_cold_storage;
+
+            static type make(const Storage&) { return {}; }
+        };
+
+    }
+
+    template<typename T, typename Storage, typename Index>
+    class dense_list;
+
+    template<typename List, bool Const>
+    class dense_list_iterator {
+
+        public:
+
+            using iterator_category = std::bidirectional_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = typename List::value_type;
+            using reference = std::conditional_t<Const, typename List::const_reference, typename List::reference>;
+            using pointer = std::add_pointer_t<std::remove_reference_t<reference>>;
+            using list_pointer = std::conditional_t<Const, const List*, List*>;
+            using index_type = typename List::index_type;
+
+            dense_list_iterator() = default;
+            dense_list_iterator(list_pointer list, index_type index)
+                : list(list), index(index) {}
+
+            // Allows iterator -> const_iterator
+            operator dense_list_iterator<List, true>() const requires (!Const) { return {list, index}; }
+
+            dense_list_iterator& operator++() {
+
+                index = list->next(index);
+                return *this;
+            }
+
+            dense_list_iterator& operator--() {
+
+                index = index == List::npos ? list->tail() : list->prev(index);
+                return *this;
+            }
+
+            dense_list_iterator operator++(int) {
+
+                dense_list_iterator it(*this);
+                ++*this;
+                return it;
+            }
+
+            dense_list_iterator operator--(int) {
+
+                dense_list_iterator it(*this);
+                --*this;
+                return it;
+            }
+
+            bool operator==(const dense_list_iterator& other) const { return index == other.index; }
+            bool operator!=(const dense_list_iterator& other) const { return !operator==(other); }
+
+            reference operator*() const { return list->get(index); }
+            pointer operator->() const { return &list->get(index); }
+
+            /**
+             * The handle of the slot this iterator points at.
+             */
+            index_type handle() const { return index; }
+
+        private:
+
+            list_pointer list = nullptr;
+            index_type index = List::npos;
+    };
+
+    /**
+     * A doubly linked list whose nodes live in one dense array of slots and link to
+     * each other with 32-bit indices instead of pointers.
+     *
+     * Every value is addressed by a handle, the index of its slot, which stays valid
+     * until the value is erased. Handles are what make the list O(1) to edit in the
+     * middle: push/pop at either end and insert/remove next to a handle never walk the
+     * list. The positional interface of intrusive_dense_list is kept as well; without an
+     * index it walks the links, so it is O(n).
+     *
+     * @tparam Storage Where the slots live. vector_storage regrows by copying;
+     *                 mapped_storage grows in place, so references to values stay valid;
+     *                 cow_storage shares chunks of slots between snapshots. On cow_storage
+     *                 the accessors only read, so reading never unshares a chunk, and values
+     *                 are changed in place through edit() and edit_cold().
+     * @tparam Index no_order_index, or order_statistics_index to make the positional
+     *               interface and position_of O(log n). This costs 24 bytes per slot,
+     *               and inserting next to a handle in the middle becomes O(log n) too.
+     */
+    template<typename T, typename Storage = vector_storage<dense_list_slot<T>>, typename Index = no_order_index>
+    class dense_list {
+
+        public:
+
+            using value_type = T;
+            using size_type = std::size_t;
+            using index_type = std::uint32_t;
+            using storage_type = Storage;
+            using slot_type = typename storage_type::slot_type;
+            using cold_type = typename slot_type::cold_type;
+            using reference = std::conditional_t<storage_type::copy_on_write, const value_type&, value_type&>;
+            using const_reference = const value_type&;
+            using cold_reference = std::add_lvalue_reference_t<std::conditional_t<storage_type::copy_on_write, std::add_const_t<cold_type>, cold_type>>;
+            using const_cold_reference = std::add_lvalue_reference_t<std::add_const_t<cold_type>>;
+            using cold_storage_type = typename detail::cold_storage_for<storage_type, cold_type>::type;
+            using iterator = dense_list_iterator<dense_list, false>;
+            using const_iterator = dense_list_iterator<dense_list, true>;
+            using reverse_iterator = std::reverse_iterator<iterator>;
+            using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+            static_assert(std::is_same_v<typename slot_type::value_type, value_type>, "The storage must hold slots of this list's value type");
+
+            static constexpr index_type npos = std::numeric_limits<index_type>::max();
+            static constexpr bool indexed = !std::is_same_v<Index, no_order_index>;
+            static constexpr bool split = !std::is_void_v<cold_type>;
+
+            dense_list()
+                : cold_slots(detail::cold_storage_for<storage_type, cold_type>::make(storage)) {}
+
+            explicit dense_list(storage_type storage)
+                : storage(std::move(storage)), cold_slots(detail::cold_storage_for<storage_type, cold_type>::make(this->storage)) {
+
+                adopt_capacity(0);
+            }
+
+            dense_list(const dense_list&) = default;
+            dense_list& operator=(const dense_list&) = default;
+
+            /**
+             * Takes the slots of another list, which is left empty and ready for reuse.
+             */
+            dense_list(dense_list&& other) noexcept
+                : storage(std::move(other.storage)), cold_slots(std::move(other.cold_slots)), head_(std::exchange(other.head_, npos)), tail_(std::exchange(other.tail_, npos)), free_(std::exchange(other.free_, npos)), size_(std::exchange(other.size_, 0)), order(std::move(other.order)) {
+
+                if constexpr (indexed) other.order.clear();
+            }
+
+            dense_list& operator=(dense_list&& other) noexcept {
+
+                dense_list(std::move(other)).swap(*this);
+                return *this;
+            }
+
+            /**
+             * Copies the list. The slot array and the index are copied as they are, which
+             * for a trivially copyable T is one memcpy per array rather than a copy per value.
+             */
+            dense_list clone() const {
+
+                return dense_list(*this, storage.clone(), cold_slots.clone());
+            }
+
+            /**
+             * Takes an immutable copy of the list for readers, possibly on other threads.
+             * The copy shares every chunk of slots with this list; editing the list afterwards
+             * copies only the chunks that are written. An index, if any, is copied in full.
+             */
+            std::shared_ptr<const dense_list> snapshot() const requires storage_type::copy_on_write {
+
+                return std::make_shared<const dense_list>(*this);
+            }
+
+            /**
+             * Makes room for at least the given number of values without further growth.
+             */
+            void reserve(size_type capacity) {
+
+                const size_type old_capacity = storage.capacity();
+                if (capacity <= old_capacity) return;
+                if (capacity > max_size()) throw std::length_error("dense_list cannot address that many slots");
+
+                storage.grow(capacity);
+                adopt_capacity(old_capacity);
+            }
+
+            /**
+             * Inserts a value in front of the value at the given position.
+             *
+             * @param location The position to insert at. size() appends.
+             * @param value The value to add.
+             * @returns the handle of the new value.
+             */
+            index_type insert(uint32_t location, const_reference value) {
+
+                if (location > size_) throw std::out_of_range("dense_list insert position out of range");
+                return insert_before(location == size_ ? npos : handle_at(location), value);
+            }
+
+            /**
+             * Inserts a value in front of the value with the given handle.
+             *
+             * @param handle The value to insert in front of, or npos to append.
+             * @param value The value to add.
+             * @returns the handle of the new value.
+             */
+            index_type insert_before(index_type handle, const_reference value) {
+
+                if (free_ == npos) {
+
+                    // The value may live in this list, and growing can move it
+                    value_type copy(value);
+                    expand();
+                    return insert_before(handle, copy);
+                }
+
+                const index_type index = free_;
+                const index_type before = handle == npos ? tail_ : storage.read(handle).prev;
+                free_ = storage.read(index).next;
+
+                slot_type& slot = storage.write(index);
+                slot.lvalue = value;
+                slot.prev = before;
+                slot.next = handle;
+
+                if (before == npos) head_ = index;
+                else storage.write(before).next = index;
+
+                if (handle == npos) tail_ = index;
+                else storage.write(handle).prev = index;
+
+                if constexpr (indexed) {
+
+                    if (handle == npos) order.push_back(index);
+                    else if (before == npos) order.push_front(index);
+                    else order.insert_before(index, handle);
+                }
+
+                ++size_;
+                return index;
+            }
+
+            /**
+             * Add an entry to the start of the list.
+             * @returns the handle of the new value.
+             */
+            index_type push_front(const_reference value) {
+
+                return insert_before(head_, value);
+            }
+
+            /**
+             * Add an entry to the end of the list.
+             * @returns the handle of the new value.
+             */
+            index_type push_back(const_reference value) {
+
+                return insert_before(npos, value);
+            }
+
+            /**
+             * Erases the value at the front of the list.
+             * @note Must not be called on an empty list.
+             */
+            void pop_front() {
+
+                if (head_ != npos) remove(head_);
+            }
+
+            /**
+             * Erases the value at the back of the list.
+             * @note Must not be called on an empty list.
+             */
+            void pop_back() {
+
+                if (tail_ != npos) remove(tail_);
+            }
+
+            /**
+             * Erases the value at the given position.
+             */
+            void erase(uint32_t idx) {
+
+                if (idx >= size_) throw std::out_of_range("dense_list erase position out of range");
+                remove(handle_at(idx));
+            }
+
+            /**
+             * Erases the value with the given handle. Its slot is reused by later inserts.
+             */
+            void remove(index_type handle) {
+
+                if constexpr (indexed) order.erase(handle);
+                unlink(handle);
+            }
+
+            /**
+             * Finds the handle of the value at the given position.
+             * O(log n) through the index.
+             */
+            index_type nth(uint32_t position) const requires indexed {
+
+                if (position >= size_) throw std::out_of_range("dense_list position out of range");
+                return order.nth(position);
+            }
+
+            /**
+             * Finds the position of the value with the given handle.
+             * O(log n) through the index.
+             */
+            size_type position_of(index_type handle) const requires indexed {
+
+                return order.position_of(handle);
+            }
+
+            /**
+             * Retrieves the value at the given position, walking the list unless it is indexed.
+             * @throws std::out_of_range if there is no such position.
+             */
+            reference operator[](uint32_t position) {
+
+                if (position >= size_) throw std::out_of_range("dense_list position out of range");
+                return get(handle_at(position));
+            }
+
+            const_reference operator[](uint32_t position) const {
+
+                if (position >= size_) throw std::out_of_range("dense_list position out of range");
+                return get(handle_at(position));
+            }
+
+            /**
+             * Retrieves the value with the given handle. Read only on copy-on-write storage.
+             */
+            reference get(index_type handle) {
+
+                if constexpr (storage_type::copy_on_write) return storage.read(handle).lvalue;
+                else return storage.write(handle).lvalue;
+            }
+
+            const_reference get(index_type handle) const { return storage.read(handle).lvalue; }
+
+            /**
+             * Retrieves the value with the given handle for changing it in place. On
+             * copy-on-write storage this unshares the chunk holding it.
+             */
+            value_type& edit(index_type handle) { return storage.write(handle).lvalue; }
+
+            /**
+             * Retrieves the cold part of the element with the given handle. Removing an
+             * element resets its cold part, so inserting leaves it value initialised. Read
+             * only on copy-on-write storage.
+             */
+            cold_reference cold(index_type handle) requires split {
+
+                if constexpr (storage_type::copy_on_write) return cold_slots.read(handle);
+                else return cold_slots.write(handle);
+            }
+
+            const_cold_reference cold(index_type handle) const requires split { return cold_slots.read(handle); }
+
+            /**
+             * Retrieves the cold part of the element with the given handle for changing it in place.
+             */
+            std::add_lvalue_reference_t<cold_type> edit_cold(index_type handle) requires split { return cold_slots.write(handle); }
+
+            index_type head() const { return head_; }
+            index_type tail() const { return tail_; }
+            index_type next(index_type handle) const { return storage.read(handle).next; }
+            index_type prev(index_type handle) const { return storage.read(handle).prev; }
+
+            /**
+             * Retrieves a reference to the value at the front of the list.
+             * @throws std::out_of_range if the list is empty.
+             */
+            reference front() {
+
+                if (head_ == npos) throw std::out_of_range("Nothing has been added to the linked list!");
+                return get(head_);
+            }
+
+            const_reference front() const {
+
+                if (head_ == npos) throw std::out_of_range("Nothing has been added to the linked list!");
+                return get(head_);
+            }
+
+            /**
+             * Retrieves a reference to the value at the back of the list.
+             * @throws std::out_of_range if the list is empty.
+             */
+            reference back() {
+
+                if (tail_ == npos) throw std::out_of_range("Nothing has been added to the linked list!");
+                return get(tail_);
+            }
+
+            const_reference back() const {
+
+                if (tail_ == npos) throw std::out_of_range("Nothing has been added to the linked list!");
+                return get(tail_);
+            }
+
+            bool empty() const { return size_ == 0; }
+            size_type size() const { return size_; }
+            size_type capacity() const { return storage.capacity(); }
+            static constexpr size_type max_size() { return npos; }
+
+            /**
+             * Erases every value. The slots stay allocated for reuse.
+             */
+            void clear() {
+
+                if constexpr (indexed) order.clear();
+                while (head_ != npos) unlink(head_);
+            }
+
+            // Iterator interface
+            iterator begin() { return {this, head_}; }
+            const_iterator begin() const { return {this, head_}; }
+            const_iterator cbegin() const { return begin(); }
+
+            iterator end() { return {this, npos}; }
+            const_iterator end() const { return {this, npos}; }
+            const_iterator cend() const { return end(); }
+
+            reverse_iterator rbegin() { return reverse_iterator(end()); }
+            const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+            reverse_iterator rend() { return reverse_iterator(begin()); }
+            const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+            storage_type& get_storage() { return storage; }
+            const storage_type& get_storage() const { return storage; }
+
+            const cold_storage_type& get_cold_storage() const requires split { return cold_slots; }
+
+            /**
+             * Exchanges contents of this list with another list instance.
+             * @param other The other list to swap with.
+             */
+            void swap(dense_list& other) noexcept {
+
+                storage.swap(other.storage);
+                cold_slots.swap(other.cold_slots);
+                std::swap(head_, other.head_);
+                std::swap(tail_, other.tail_);
+                std::swap(free_, other.free_);
+                std::swap(size_, other.size_);
+                if constexpr (indexed) order.swap(other.order);
+            }
+
+        private:
+
+            dense_list(const dense_list& other, storage_type&& storage, cold_storage_type&& cold_slots)
+                : storage(std::move(storage)), cold_slots(std::move(cold_slots)), head_(other.head_), tail_(other.tail_), free_(other.free_), size_(other.size_), order(other.order) {}
+
+            index_type handle_at(uint32_t position) const {
+
+                if constexpr (indexed) return order.nth(position);
+
+                // Walk from whichever end is closer
+                if (position < size_ / 2) {
+
+                    index_type index = head_;
+                    while (position-- > 0) index = next(index);
+                    return index;
+                }
+
+                index_type index = tail_;
+                for (size_type steps = size_ - 1 - position; steps > 0; --steps) index = prev(index);
+                return index;
+            }
+
+            void expand() {
+
+                const size_type capacity = storage.capacity();
+                if (capacity >= max_size()) throw std::length_error("dense_list cannot address that many slots");
+                reserve(capacity < 16 ? 16 : std::min(capacity * 2, max_size()));
+            }
+
+            void unlink(index_type handle) {
+
+                const slot_type& slot = storage.read(handle);
+                const index_type before = slot.prev;
+                const index_type after = slot.next;
+
+                if (before == npos) head_ = after;
+                else storage.write(before).next = after;
+
+                if (after == npos) tail_ = before;
+                else storage.write(after).prev = before;
+
+                if constexpr (!std::is_trivially_destructible_v<value_type>) storage.write(handle).lvalue = value_type{};
+                if constexpr (split) cold_slots.write(handle) = cold_type{};
+
+                release(handle);
+                --size_;
+            }
+
+            void release(index_type index) {
+
+                storage.write(index).next = free_;
+                free_ = index;
+            }
+
+            /**
+             * Chains the slots the storage has added since old_capacity into the free list.
+             * The storage may round the capacity up, so every slot it reports is used.
+             */
+            void adopt_capacity(size_type old_capacity) {
+
+                const size_type capacity = storage.capacity() < max_size() ? storage.capacity() : max_size();
+
+                for (size_type index = capacity; index-- > old_capacity;) {
+
+                    storage.write(index).next = free_;
+                    free_ = static_cast<index_type>(index);
+                }
+
+                if constexpr (indexed) order.reserve(capacity);
+                if constexpr (split) cold_slots.grow(capacity);
+            }
+
+            storage_type storage;
+            [[no_unique_address]] cold_storage_type cold_slots;
+            index_type head_ = npos;
+            index_type tail_ = npos;
+            index_type free_ = npos;
+            size_type size_ = 0;
+            [[no_unique_address]] Index order;
+    };
+
+    template<typename T, typename Storage, typename Index>
+    void swap(dense_list<T, Storage, Index>& lhs, dense_list<T, Storage, Index>& rhs) noexcept {
+
+        lhs.swap(rhs);
+    }
+
+}
@@ -0,0 +1,315 @@
+// This file is part of the mcl project.
+// Copyright (c) 2022 merryhime
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "intrusive_list.hpp"
+
+namespace mlc {
+
+    template<typename T>
+    class dense_slot_pool;
+
+    /**
+     * A fixed size stack of free slot indices. Magazines are the unit in which slots
+     * move between a thread's cache and the pool's depot.
+     *
+     * A magazine is written on every insert and erase by the thread that holds it, so it
+     * takes whole cache lines and never shares one with another thread's magazine.
+     */
+    class alignas(64) slot_magazine final : public mcl::intrusive_list_node<slot_magazine> {
+
+        public:
+
+            using index_type = std::uint32_t;
+            static constexpr std::size_t capacity = 64;
+
+            bool empty() const { return count == 0; }
+            bool full() const { return count == capacity; }
+            std::size_t size() const { return count; }
+
+            void push(index_type index) {
+
+                slots[count++] = index;
+            }
+
+            index_type pop() {
+
+                return slots[--count];
+            }
+
+        private:
+
+            std::size_t count = 0;
+            std::array<index_type, capacity> slots;
+    };
+
+    /**
+     * A pool of slots in one contiguous array that is shared by many threads.
+     *
+     * Free slots are kept in magazines of slot_magazine::capacity indices. The depot holds
+     * the magazines that are not owned by a thread: a list of magazines with free slots
+     * and a list of empty ones. Threads never touch the depot for single slots. Each
+     * thread owns a thread_cache that hands slots out of, and back into, two magazines of
+     * its own, and only takes the depot lock to swap a whole magazine.
+     *
+     * A cache keeps up to two magazines of free slots to itself until it is flushed or
+     * destroyed, so a pool shared by n threads should have room for the values it holds
+     * plus 2 * n * slot_magazine::capacity slots.
+     *
+     * @note Every thread_cache must be destroyed before its pool.
+     */
+    template<typename T>
+    class dense_slot_pool {
+
+        public:
+
+            using value_type = T;
+            using size_type = std::size_t;
+            using index_type = slot_magazine::index_type;
+            using reference = value_type&;
+            using const_reference = const value_type&;
+
+            /**
+             * The per-thread front end of a pool. Construct one for each thread that uses
+             * the pool, for example as a thread_local, and use it for every insert and erase
+             * on that thread.
+             */
+            class alignas(64) thread_cache {
+
+                public:
+
+                    explicit thread_cache(dense_slot_pool& pool)
+                        : pool(pool), loaded(pool.take_empty()), previous(pool.take_empty()) {}
+
+                    ~thread_cache() noexcept {
+
+                        pool.retire(loaded);
+                        pool.retire(previous);
+                    }
+
+                    thread_cache(const thread_cache&) = delete;
+                    thread_cache& operator=(const thread_cache&) = delete;
+
+                    /**
+                     * Takes a free slot.
+                     * @returns the index of the slot.
+                     * @throws std::bad_alloc if neither this cache nor the depot has a free slot.
+                     * Free slots cached by other threads are not taken; see flush().
+                     */
+                    index_type allocate() {
+
+                        if (loaded->empty()) {
+
+                            if (previous->empty()) previous = pool.exchange_empty(previous);
+                            std::swap(loaded, previous);
+                        }
+
+                        return loaded->pop();
+                    }
+
+                    /**
+                     * Gives a slot back to the pool.
+                     * @param index A slot taken from the same pool, on any thread.
+                     */
+                    void deallocate(index_type index) {
+
+                        if (loaded->full()) {
+
+                            if (previous->full()) previous = pool.exchange_full(previous);
+                            std::swap(loaded, previous);
+                        }
+
+                        loaded->push(index);
+                    }
+
+                    /**
+                     * Gives every free slot this cache holds back to the depot, so that other
+                     * threads can take them. Call it when the thread goes idle.
+                     */
+                    void flush() {
+
+                        std::lock_guard guard(pool.depot_lock);
+                        loaded = pool.swap_for_empty(loaded);
+                        previous = pool.swap_for_empty(previous);
+                    }
+
+                    /**
+                     * Constructs a value in a free slot.
+                     * @returns the index of the slot.
+                     */
+                    template<typename... Args>
+                    index_type insert(Args&&... args) {
+
+                        const index_type index = allocate();
+                        ::new (static_cast<void*>(pool.slots[index].bytes)) value_type(std::forward<Args>(args)...);
+                        return index;
+                    }
+
+                    /**
+                     * Destroys the value in a slot and gives the slot back to the pool.
+                     * @param index A slot returned by insert on the same pool.
+                     */
+                    void erase(index_type index) {
+
+                        pool[index].~value_type();
+                        deallocate(index);
+                    }
+
+                private:
+
+                    dense_slot_pool& pool;
+                    slot_magazine* loaded;
+                    slot_magazine* previous;
+            };
+
+            /**
+             * Creates a pool with every slot free.
+             * @param capacity The number of slots, fixed for the lifetime of the pool.
+             */
+            explicit dense_slot_pool(size_type capacity)
+                : slots(new slot[capacity]), capacity_(capacity) {
+
+                slot_magazine* magazine = nullptr;
+
+                // Hand out the low indices first so a lightly used pool stays compact
+                for (size_type index = capacity; index-- > 0;) {
+
+                    if (magazine == nullptr || magazine->full()) {
+
+                        magazine = new slot_magazine;
+                        stocked.push_front(*magazine);
+                    }
+
+                    magazine->push(static_cast<index_type>(index));
+                }
+            }
+
+            ~dense_slot_pool() noexcept {
+
+                release(stocked);
+                release(drained);
+            }
+
+            dense_slot_pool(const dense_slot_pool&) = delete;
+            dense_slot_pool& operator=(const dense_slot_pool&) = delete;
+
+            reference operator[](index_type index) {
+
+                return *std::launder(reinterpret_cast<value_type*>(slots[index].bytes));
+            }
+
+            const_reference operator[](index_type index) const {
+
+                return *std::launder(reinterpret_cast<const value_type*>(slots[index].bytes));
+            }
+
+            /**
+             * Gets the number of slots in this pool.
+             */
+            size_type capacity() const {
+
+                return capacity_;
+            }
+
+        private:
+
+            struct slot {
+
+                alignas(value_type) unsigned char bytes[sizeof(value_type)];
+            };
+
+            /**
+             * Trades an empty magazine for one that has free slots.
+             */
+            slot_magazine* exchange_empty(slot_magazine* empty) {
+
+                std::lock_guard guard(depot_lock);
+                if (stocked.empty()) throw std::bad_alloc();
+
+                slot_magazine& result = stocked.front();
+                stocked.pop_front();
+                drained.push_front(*empty);
+                return &result;
+            }
+
+            /**
+             * Trades a full magazine for an empty one. New magazines are only created
+             * while the threads' caches warm up; afterwards the depot always has one.
+             */
+            slot_magazine* exchange_full(slot_magazine* full) {
+
+                std::lock_guard guard(depot_lock);
+                stocked.push_front(*full);
+                return pop_drained();
+            }
+
+            /**
+             * Gets an empty magazine for a new cache, reusing one from the depot if it has any.
+             */
+            slot_magazine* take_empty() {
+
+                std::lock_guard guard(depot_lock);
+                return pop_drained();
+            }
+
+            /**
+             * Puts a magazine with free slots into the depot and gives back an empty one.
+             * @note The depot lock must be held.
+             */
+            slot_magazine* swap_for_empty(slot_magazine* magazine) {
+
+                if (magazine->empty()) return magazine;
+
+                stocked.push_front(*magazine);
+                return pop_drained();
+            }
+
+            /**
+             * Takes an empty magazine out of the depot, or makes one if it has none.
+             * @note The depot lock must be held.
+             */
+            slot_magazine* pop_drained() {
+
+                if (drained.empty()) return new slot_magazine;
+
+                slot_magazine& result = drained.front();
+                drained.pop_front();
+                return &result;
+            }
+
+            void retire(slot_magazine* magazine) noexcept {
+
+                std::lock_guard guard(depot_lock);
+                if (magazine->empty()) drained.push_front(*magazine);
+                else stocked.push_front(*magazine);
+            }
+
+            static void release(mcl::intrusive_list<slot_magazine>& magazines) noexcept {
+
+                while (!magazines.empty()) {
+
+                    slot_magazine& magazine = magazines.front();
+                    magazines.pop_front();
+                    delete &magazine;
+                }
+            }
+
+            std::unique_ptr<slot[]> slots;
+            size_type capacity_;
+
+            alignas(64) std::mutex depot_lock;
+            mcl::intrusive_list<slot_magazine> stocked;
+            mcl::intrusive_list<slot_magazine> drained;
+    };
+
+}
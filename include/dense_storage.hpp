@@ -0,0 +1,443 @@
+// This file is part of the mcl project.
+// Copyright (c) 2022 merryhime
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mlc {
+
+    /**
+     * Slot storage on a std::vector. Growing may move every slot to a new buffer, so
+     * references into the storage are invalidated by grow().
+     */
+    template<typename Slot>
+    class vector_storage {
+
+        public:
+
+            using slot_type = Slot;
+            using size_type = std::size_t;
+
+            static constexpr bool stable_addresses = false;
+            static constexpr bool copy_on_write = false;
+
+            template<typename Other>
+            using rebind = vector_storage<Other>;
+
+            slot_type* data() { return slots.data(); }
+            const slot_type* data() const { return slots.data(); }
+            size_type capacity() const { return slots.size(); }
+
+            /**
+             * Makes an empty storage for another slot type, set up like this one.
+             */
+            template<typename Other>
+            rebind<Other> sibling() const { return {}; }
+
+            const slot_type& read(size_type index) const { return slots[index]; }
+            slot_type& write(size_type index) { return slots[index]; }
+
+            /**
+             * Makes room for at least the given number of slots, keeping the existing ones.
+             * New slots are default constructed.
+             */
+            void grow(size_type min_capacity) {
+
+                if (min_capacity > slots.size()) slots.resize(min_capacity);
+            }
+
+            /**
+             * Copies every slot. std::vector already copies trivially copyable slots with memcpy.
+             */
+            vector_storage clone() const {
+
+                return *this;
+            }
+
+            void swap(vector_storage& other) noexcept {
+
+                slots.swap(other.slots);
+            }
+
+        private:
+
+            std::vector<slot_type> slots;
+    };
+
+    struct mapped_storage_options {
+
+        // Address space reserved up front, rounded up to whole commit pieces of 2 MiB.
+        // Only the part in use is ever committed.
+        std::size_t reserve_bytes = std::size_t{1} << 36;
+
+        // Ask for transparent huge pages on the reservation.
+        bool huge_pages = true;
+
+        // NUMA node to bind the memory to, or -1 to leave the kernel's policy alone.
+        int numa_node = -1;
+
+        // Write to every new page from the growing thread, so that without an explicit
+        // binding the pages land on that thread's node.
+        bool first_touch = true;
+    };
+
+    /**
+     * Slot storage on a reserved range of virtual memory.
+     *
+     * The whole range is reserved with mmap when the storage is created and committed
+     * piece by piece as it grows, so growing never copies and slots never move. Huge
+     * pages and NUMA binding are requested on a best effort basis; when the kernel
+     * refuses them the storage works the same, only with ordinary pages.
+     */
+    template<typename Slot>
+    class mapped_storage {
+
+        public:
+
+            using slot_type = Slot;
+            using size_type = std::size_t;
+
+            static constexpr bool stable_addresses = true;
+            static constexpr bool copy_on_write = false;
+            static constexpr size_type commit_granularity = size_type{2} << 20;
+
+            template<typename Other>
+            using rebind = mapped_storage<Other>;
+
+            mapped_storage()
+                : mapped_storage(mapped_storage_options{}) {}
+
+            explicit mapped_storage(const mapped_storage_options& options)
+                : options(options) {
+
+                reserve();
+            }
+
+            mapped_storage(mapped_storage&& other) noexcept
+                : options(other.options) {
+
+                // The moved-from storage keeps its options for when it reserves again
+                swap(other);
+            }
+
+            mapped_storage& operator=(mapped_storage&& other) noexcept {
+
+                mapped_storage(std::move(other)).swap(*this);
+                return *this;
+            }
+
+            ~mapped_storage() noexcept {
+
+                if (mapping == nullptr) return;
+
+                std::destroy_n(data(), capacity_);
+                ::munmap(mapping, mapping_bytes);
+            }
+
+            slot_type* data() { return static_cast<slot_type*>(base); }
+            const slot_type* data() const { return static_cast<const slot_type*>(base); }
+            size_type capacity() const { return capacity_; }
+
+            const slot_type& read(size_type index) const { return data()[index]; }
+            slot_type& write(size_type index) { return data()[index]; }
+
+            /**
+             * The largest capacity this storage can grow to without a new reservation.
+             */
+            size_type max_capacity() const { return reserved_bytes / sizeof(slot_type); }
+
+            /**
+             * Makes an empty storage for another slot type with the same options, reserving
+             * room for at least as many slots as this one. The reservation never drops
+             * below one commit piece, however small the other slot type is.
+             */
+            template<typename Other>
+            rebind<Other> sibling() const {
+
+                const size_type slots = mapping != nullptr ? max_capacity() : options.reserve_bytes / sizeof(slot_type);
+
+                mapped_storage_options result = options;
+                result.reserve_bytes = std::max(slots * sizeof(Other), commit_granularity);
+                return rebind<Other>(result);
+            }
+
+            /**
+             * Did the kernel accept the transparent huge page request?
+             */
+            bool huge_pages() const { return huge_pages_; }
+
+            /**
+             * Is the memory bound to the requested NUMA node?
+             */
+            bool numa_bound() const { return numa_bound_; }
+
+            /**
+             * Commits room for at least the given number of slots. Existing slots stay
+             * where they are. New slots are default constructed.
+             *
+             * @throws std::bad_alloc if the reservation is exhausted or the kernel cannot commit more memory.
+             */
+            void grow(size_type min_capacity) {
+
+                if (min_capacity <= capacity_) return;
+
+                commit(min_capacity, options.first_touch);
+
+                // Fill the whole committed range so the next few grows are free
+                const size_type new_capacity = committed_bytes / sizeof(slot_type);
+                std::uninitialized_default_construct_n(data() + capacity_, new_capacity - capacity_);
+                capacity_ = new_capacity;
+            }
+
+            /**
+             * Copies every slot into a new reservation with the same options. Trivially
+             * copyable slots are copied with a single memcpy, which also does the first touch.
+             */
+            mapped_storage clone() const {
+
+                mapped_storage result(options);
+                if (capacity_ == 0) return result;
+
+                if constexpr (std::is_trivially_copyable_v<slot_type>) {
+
+                    result.commit(capacity_, false);
+                    std::memcpy(result.base, base, capacity_ * sizeof(slot_type));
+                }
+                else {
+
+                    result.commit(capacity_, options.first_touch);
+                    std::uninitialized_copy_n(data(), capacity_, result.data());
+                }
+
+                const size_type new_capacity = result.committed_bytes / sizeof(slot_type);
+                std::uninitialized_default_construct_n(result.data() + capacity_, new_capacity - capacity_);
+                result.capacity_ = new_capacity;
+                return result;
+            }
+
+            void swap(mapped_storage& other) noexcept {
+
+                std::swap(options, other.options);
+                std::swap(mapping, other.mapping);
+                std::swap(mapping_bytes, other.mapping_bytes);
+                std::swap(base, other.base);
+                std::swap(reserved_bytes, other.reserved_bytes);
+                std::swap(committed_bytes, other.committed_bytes);
+                std::swap(capacity_, other.capacity_);
+                std::swap(huge_pages_, other.huge_pages_);
+                std::swap(numa_bound_, other.numa_bound_);
+            }
+
+        private:
+
+            /**
+             * Makes the reservation readable and writable up to at least the given number of
+             * slots, without constructing anything in it.
+             */
+            void commit(size_type min_capacity, bool first_touch) {
+
+                // A moved-from storage has no reservation until it is used again
+                if (mapping == nullptr) reserve();
+                if (min_capacity > max_capacity()) throw std::bad_alloc();
+
+                const size_type needed = min_capacity * sizeof(slot_type);
+                if (needed <= committed_bytes) return;
+
+                size_type target = (needed + commit_granularity - 1) / commit_granularity * commit_granularity;
+                if (target > reserved_bytes) target = reserved_bytes;
+
+                auto* first = static_cast<unsigned char*>(base) + committed_bytes;
+                if (::mprotect(first, target - committed_bytes, PROT_READ | PROT_WRITE) != 0) throw std::bad_alloc();
+
+                if (first_touch) touch(first, target - committed_bytes);
+                committed_bytes = target;
+            }
+
+            /**
+             * Reserves the address range, halving the request until the kernel accepts it.
+             * The usable range is aligned to the commit granularity so that it can be
+             * backed by huge pages.
+             */
+            void reserve() {
+
+                // Reserve whole commit pieces, so a small request still gets one
+                size_type request = options.reserve_bytes < commit_granularity ? commit_granularity : options.reserve_bytes;
+                if (request % commit_granularity != 0 && request <= std::numeric_limits<size_type>::max() - 2 * commit_granularity)
+                    request += commit_granularity - request % commit_granularity;
+
+                void* result = MAP_FAILED;
+
+                while (request >= commit_granularity) {
+
+                    result = ::mmap(nullptr, request + commit_granularity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                    if (result != MAP_FAILED) break;
+                    request /= 2;
+                }
+
+                if (result == MAP_FAILED) throw std::bad_alloc();
+
+                mapping = result;
+                mapping_bytes = request + commit_granularity;
+
+                const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+                const auto aligned = (address + commit_granularity - 1) / commit_granularity * commit_granularity;
+                base = reinterpret_cast<void*>(aligned);
+                reserved_bytes = request;
+
+        #if defined(MADV_HUGEPAGE)
+                if (options.huge_pages) huge_pages_ = ::madvise(base, reserved_bytes, MADV_HUGEPAGE) == 0;
+        #endif
+
+        #if defined(SYS_mbind)
+                if (options.numa_node >= 0) numa_bound_ = bind(options.numa_node);
+        #endif
+            }
+
+        #if defined(SYS_mbind)
+            bool bind(int node) {
+
+                // MPOL_BIND from <numaif.h>, spelled out so that libnuma is not needed
+                constexpr int mpol_bind = 2;
+                constexpr unsigned long bits = sizeof(unsigned long) * 8;
+
+                if (node >= 1024) return false;
+
+                unsigned long mask[1024 / bits] = {};
+                mask[node / bits] = 1UL << (node % bits);
+
+                return ::syscall(SYS_mbind, base, reserved_bytes, mpol_bind, mask, 1024UL, 0U) == 0;
+            }
+        #endif
+
+            static void touch(unsigned char* first, size_type bytes) {
+
+                const auto page = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+                for (size_type offset = 0; offset < bytes; offset += page) first[offset] = 0;
+            }
+
+            mapped_storage_options options;
+            void* mapping = nullptr;
+            size_type mapping_bytes = 0;
+            void* base = nullptr;
+            size_type reserved_bytes = 0;
+            size_type committed_bytes = 0;
+            size_type capacity_ = 0;
+            bool huge_pages_ = false;
+            bool numa_bound_ = false;
+    };
+
+    /**
+     * Slot storage made of fixed size chunks that are shared between copies.
+     *
+     * Copying the storage only copies the table of chunk pointers. A chunk that is
+     * shared is copied the first time one of its slots is written, so a list that keeps
+     * being edited after a copy was taken only pays for the chunks it touches. This is
+     * what makes dense_list::snapshot cheap.
+     *
+     * Copies may be read from other threads while the original is written to, as long as
+     * only one thread writes to the original and the copies are never written.
+     */
+    template<typename Slot, std::size_t ChunkBytes = 16 * 1024>
+    class cow_storage {
+
+        public:
+
+            using slot_type = Slot;
+            using size_type = std::size_t;
+
+            static constexpr bool stable_addresses = false;
+            static constexpr bool copy_on_write = true;
+            static constexpr size_type chunk_slots = std::bit_floor(ChunkBytes / sizeof(slot_type) > 0 ? ChunkBytes / sizeof(slot_type) : size_type{1});
+
+            template<typename Other>
+            using rebind = cow_storage<Other, ChunkBytes>;
+
+            size_type capacity() const { return chunks.size() * chunk_slots; }
+
+            /**
+             * Makes an empty storage for another slot type, set up like this one.
+             */
+            template<typename Other>
+            rebind<Other> sibling() const { return {}; }
+
+            const slot_type& read(size_type index) const {
+
+                return chunks[index / chunk_slots]->slots[index % chunk_slots];
+            }
+
+            slot_type& write(size_type index) {
+
+                std::shared_ptr<chunk>& owner = chunks[index / chunk_slots];
+
+                // A reader that let go of the chunk did so with a release; see its reads
+                // before overwriting the slot in place
+                if (owner.use_count() > 1) owner = std::make_shared<chunk>(*owner);
+                else std::atomic_thread_fence(std::memory_order_acquire);
+
+                return owner->slots[index % chunk_slots];
+            }
+
+            /**
+             * Adds chunks until there is room for at least the given number of slots.
+             * New slots are default constructed.
+             */
+            void grow(size_type min_capacity) {
+
+                chunks.reserve((min_capacity + chunk_slots - 1) / chunk_slots);
+                while (capacity() < min_capacity) chunks.push_back(std::make_shared<chunk>());
+            }
+
+            /**
+             * Copies every chunk, so that nothing is shared with this storage.
+             */
+            cow_storage clone() const {
+
+                cow_storage result;
+                result.chunks.reserve(chunks.size());
+                for (const auto& owner : chunks) result.chunks.push_back(std::make_shared<chunk>(*owner));
+                return result;
+            }
+
+            /**
+             * Gets the number of chunks that are also used by another copy.
+             */
+            size_type shared_chunks() const {
+
+                size_type count = 0;
+                for (const auto& owner : chunks) count += owner.use_count() > 1;
+                return count;
+            }
+
+            void swap(cow_storage& other) noexcept {
+
+                chunks.swap(other.chunks);
+            }
+
+        private:
+
+            struct chunk {
+
+                slot_type slots[chunk_slots];
+            };
+
+            std::vector<std::shared_ptr<chunk>> chunks;
+    };
+
+}
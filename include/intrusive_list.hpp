@@ -17,6 +17,12 @@ namespace mcl {
     template<typename T>
     class intrusive_list;
 
+    template<typename T>
+    class intrusive_list_sentinel;
+
+    template<typename T>
+    class intrusive_list_iterator;
+
     template<typename T>
     class intrusive_list_node {
 
@@ -31,6 +37,9 @@ namespace mcl {
             bool is_sentinel_ = false;
 
             friend class intrusive_list<T>;
+            friend class intrusive_list_sentinel<T>;
+            friend class intrusive_list_iterator<T>;
+            friend class intrusive_list_iterator<const T>;
     };
 
     template<typename T>
@@ -202,7 +211,7 @@ namespace mcl {
             }
             void push_front(reference node)
             {
-                insert(begin(), node);
+                insert(begin(), &node);
             }
 
             /**
@@ -213,6 +222,10 @@ namespace mcl {
             {
                 insert(end(), node);
             }
+            void push_back(reference node)
+            {
+                insert(end(), &node);
+            }
 
             /**
              * Erases the node at the front of the list.
@@ -385,6 +398,33 @@ namespace mcl {
                 return erase(iterator(node));
             }
 
+            /**
+             * Moves every node of another list in front of the given position.
+             * Runs in constant time regardless of how many nodes are moved.
+             *
+             * @param position Location to insert the other list's nodes in front of.
+             * @param other The list to take the nodes from. It is left empty.
+             */
+            void splice(iterator position, intrusive_list& other)
+            {
+                DEBUG_ASSERT(this != &other);
+
+                if (other.empty())
+                    return;
+
+                auto existing_node = position.AsNodePointer();
+                auto first = other.root->next;
+                auto last = other.root->prev;
+
+                first->prev = existing_node->prev;
+                last->next = existing_node;
+                existing_node->prev->next = first;
+                existing_node->prev = last;
+
+                other.root->next = other.root.get();
+                other.root->prev = other.root.get();
+            }
+
             /**
              * Exchanges contents of this list with another list instance.
              * @param other The other list to swap with.
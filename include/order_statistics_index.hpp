@@ -0,0 +1,382 @@
+// This file is part of the mcl project.
+// Copyright (c) 2022 merryhime
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace mlc {
+
+    /**
+     * Index policy for a dense_list that keeps no index. Positional access walks the links.
+     */
+    struct no_order_index {};
+
+    /**
+     * Positions of the slots of a dense_list in their linked order, kept as an implicit
+     * treap over the slot indices: every slot is a tree node that knows the size of its
+     * subtree, so the k-th slot and the position of a slot are found in O(log n).
+     *
+     * Slots pushed onto either end of the list are not put into the treap straight away
+     * but into a buffer for that end. A buffer is a small deque: slots leave it in O(1)
+     * from either of its ends, so push and pop at the ends of the list stay O(1) whichever
+     * end they come off, as when the list is used as a FIFO. A buffer is only folded into
+     * the treap when an edit lands strictly inside it.
+     */
+    class order_statistics_index {
+
+        public:
+
+            using index_type = std::uint32_t;
+            using size_type = std::size_t;
+
+            static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+            /**
+             * Makes room for slot indices below the given capacity.
+             */
+            void reserve(size_type capacity) {
+
+                if (capacity > nodes.size()) nodes.resize(capacity);
+            }
+
+            size_type size() const {
+
+                return front.size() + count(root) + back.size();
+            }
+
+            void push_front(index_type slot) {
+
+                place_in(slot, where::front, front);
+            }
+
+            void push_back(index_type slot) {
+
+                place_in(slot, where::back, back);
+            }
+
+            /**
+             * Adds a slot in front of another one that is already indexed.
+             */
+            void insert_before(index_type slot, index_type before) {
+
+                insert_at(position_of(before), slot);
+            }
+
+            /**
+             * Adds a slot at the given position.
+             */
+            void insert_at(size_type position, index_type slot) {
+
+                if (position == 0) return push_front(slot);
+                if (position == size()) return push_back(slot);
+
+                if (position < front.size()) flush_front();
+                else if (position > front.size() + count(root)) flush_back();
+
+                tree_insert(position - front.size(), slot);
+            }
+
+            /**
+             * Removes a slot from the index.
+             */
+            void erase(index_type slot) {
+
+                node& target = nodes[slot];
+
+                if (target.place == where::front) {
+
+                    if (pop_end(front, target.offset)) return;
+                    flush_front();
+                }
+                else if (target.place == where::back) {
+
+                    if (pop_end(back, target.offset)) return;
+                    flush_back();
+                }
+
+                tree_erase(slot);
+            }
+
+            /**
+             * Finds the slot at the given position.
+             * @note The position must be less than size().
+             */
+            index_type nth(size_type position) const {
+
+                if (position < front.size()) return front.from_outer(position);
+                position -= front.size();
+
+                if (position < count(root)) return tree_nth(position);
+                return back.from_inner(position - count(root));
+            }
+
+            /**
+             * Finds the position of an indexed slot.
+             */
+            size_type position_of(index_type slot) const {
+
+                const node& target = nodes[slot];
+
+                if (target.place == where::front) return front.size() - 1 - front.depth(target.offset);
+                if (target.place == where::back) return front.size() + count(root) + back.depth(target.offset);
+                return front.size() + rank(slot);
+            }
+
+            void clear() {
+
+                front.clear();
+                back.clear();
+                root = npos;
+            }
+
+            void swap(order_statistics_index& other) noexcept {
+
+                nodes.swap(other.nodes);
+                std::swap(front, other.front);
+                std::swap(back, other.back);
+                std::swap(root, other.root);
+                std::swap(seed, other.seed);
+            }
+
+        private:
+
+            enum class where : std::uint8_t { tree, front, back };
+
+            /**
+             * The slots at one end of the list, outside the treap. They are stored from the
+             * treap outwards, so the end of the list is the last item. Slots taken off the
+             * side next to the treap only move `inner` forward; the dead prefix is dropped
+             * once it makes up half the items.
+             */
+            struct end_buffer {
+
+                std::vector<index_type> items;
+                size_type inner = 0;
+
+                size_type size() const { return items.size() - inner; }
+                bool empty() const { return size() == 0; }
+
+                // How far an item is from the treap side
+                size_type depth(size_type offset) const { return offset - inner; }
+
+                index_type from_inner(size_type depth) const { return items[inner + depth]; }
+                index_type from_outer(size_type depth) const { return items[items.size() - 1 - depth]; }
+
+                void clear() {
+
+                    items.clear();
+                    inner = 0;
+                }
+            };
+
+            struct node {
+
+                index_type left;
+                index_type right;
+                index_type parent;
+                std::uint32_t priority;
+
+                // Subtree size while in the treap, index into the buffer otherwise
+                std::uint32_t offset;
+                where place;
+            };
+
+            void place_in(index_type slot, where place, end_buffer& buffer) {
+
+                nodes[slot].place = place;
+                nodes[slot].offset = static_cast<std::uint32_t>(buffer.items.size());
+                buffer.items.push_back(slot);
+            }
+
+            /**
+             * Takes the slot at the given offset out of a buffer if it sits at either end of it.
+             * @returns false if the slot is inside the buffer and was left alone.
+             */
+            bool pop_end(end_buffer& buffer, size_type offset) {
+
+                if (offset + 1 == buffer.items.size()) buffer.items.pop_back();
+                else if (offset == buffer.inner) ++buffer.inner;
+                else return false;
+
+                if (buffer.empty()) buffer.clear();
+                else if (buffer.inner >= 32 && buffer.inner * 2 >= buffer.items.size()) compact(buffer);
+                return true;
+            }
+
+            /**
+             * Drops the dead prefix of a buffer. The items that move were paid for by the
+             * pops that made the prefix, so this is amortised O(1).
+             */
+            void compact(end_buffer& buffer) {
+
+                buffer.items.erase(buffer.items.begin(), buffer.items.begin() + static_cast<std::ptrdiff_t>(buffer.inner));
+                buffer.inner = 0;
+
+                for (size_type i = 0; i < buffer.items.size(); ++i) nodes[buffer.items[i]].offset = static_cast<std::uint32_t>(i);
+            }
+
+            /**
+             * Moves the front buffer into the treap, closest to the treap first.
+             */
+            void flush_front() {
+
+                for (size_type i = front.inner; i < front.items.size(); ++i) tree_insert(0, front.items[i]);
+                front.clear();
+            }
+
+            void flush_back() {
+
+                for (size_type i = back.inner; i < back.items.size(); ++i) tree_insert(count(root), back.items[i]);
+                back.clear();
+            }
+
+            size_type count(index_type subtree) const {
+
+                return subtree == npos ? 0 : nodes[subtree].offset;
+            }
+
+            void update(index_type subtree) {
+
+                node& target = nodes[subtree];
+                target.offset = static_cast<std::uint32_t>(1 + count(target.left) + count(target.right));
+            }
+
+            void attach_left(index_type parent, index_type child) {
+
+                nodes[parent].left = child;
+                if (child != npos) nodes[child].parent = parent;
+            }
+
+            void attach_right(index_type parent, index_type child) {
+
+                nodes[parent].right = child;
+                if (child != npos) nodes[child].parent = parent;
+            }
+
+            void set_root(index_type subtree) {
+
+                root = subtree;
+                if (subtree != npos) nodes[subtree].parent = npos;
+            }
+
+            /**
+             * Splits a subtree into its first `position` nodes and the rest.
+             */
+            std::pair<index_type, index_type> split(index_type subtree, size_type position) {
+
+                if (subtree == npos) return {npos, npos};
+
+                node& target = nodes[subtree];
+                const size_type left_count = count(target.left);
+
+                if (position <= left_count) {
+
+                    auto [first, second] = split(target.left, position);
+                    attach_left(subtree, second);
+                    update(subtree);
+                    return {first, subtree};
+                }
+
+                auto [first, second] = split(target.right, position - left_count - 1);
+                attach_right(subtree, first);
+                update(subtree);
+                return {subtree, second};
+            }
+
+            index_type merge(index_type first, index_type second) {
+
+                if (first == npos) return second;
+                if (second == npos) return first;
+
+                if (nodes[first].priority > nodes[second].priority) {
+
+                    attach_right(first, merge(nodes[first].right, second));
+                    update(first);
+                    return first;
+                }
+
+                attach_left(second, merge(first, nodes[second].left));
+                update(second);
+                return second;
+            }
+
+            void tree_insert(size_type position, index_type slot) {
+
+                node& target = nodes[slot];
+                target.left = npos;
+                target.right = npos;
+                target.priority = next_priority();
+                target.offset = 1;
+                target.place = where::tree;
+
+                auto [first, second] = split(root, position);
+                set_root(merge(merge(first, slot), second));
+            }
+
+            void tree_erase(index_type slot) {
+
+                const node& target = nodes[slot];
+                const index_type parent = target.parent;
+                const index_type joined = merge(target.left, target.right);
+
+                if (parent == npos) return set_root(joined);
+
+                if (nodes[parent].left == slot) attach_left(parent, joined);
+                else attach_right(parent, joined);
+
+                for (index_type ancestor = parent; ancestor != npos; ancestor = nodes[ancestor].parent) update(ancestor);
+            }
+
+            index_type tree_nth(size_type position) const {
+
+                index_type subtree = root;
+
+                while (true) {
+
+                    const node& target = nodes[subtree];
+                    const size_type left_count = count(target.left);
+
+                    if (position < left_count) subtree = target.left;
+                    else if (position == left_count) return subtree;
+                    else {
+                        position -= left_count + 1;
+                        subtree = target.right;
+                    }
+                }
+            }
+
+            size_type rank(index_type slot) const {
+
+                size_type result = count(nodes[slot].left);
+
+                for (index_type child = slot, parent = nodes[slot].parent; parent != npos; child = parent, parent = nodes[parent].parent) {
+
+                    if (nodes[parent].right == child) result += count(nodes[parent].left) + 1;
+                }
+
+                return result;
+            }
+
+            std::uint32_t next_priority() {
+
+                // xorshift32
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                return seed;
+            }
+
+            std::vector<node> nodes;
+            end_buffer front;
+            end_buffer back;
+            index_type root = npos;
+            std::uint32_t seed = 2463534242u;
+    };
+
+}
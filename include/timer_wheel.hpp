@@ -0,0 +1,253 @@
+// This file is part of the mcl project.
+// Copyright (c) 2022 merryhime
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "assert.hpp"
+#include "intrusive_list.hpp"
+
+namespace mcl {
+
+    template<typename T, std::size_t Levels, std::size_t SlotBits>
+    class timer_wheel;
+
+    template<typename T>
+    class timer_wheel_node : public intrusive_list_node<T> {
+
+        public:
+
+            using tick_type = std::uint64_t;
+
+            /**
+             * The tick this timer was last scheduled to fire on.
+             */
+            inline tick_type expiry() const { return expiry_; }
+
+            /**
+             * Is this timer currently linked into a wheel?
+             * @returns true if the timer is waiting to expire.
+             */
+            inline bool is_scheduled() const { return bucket_ != nullptr; }
+
+        private:
+
+            tick_type expiry_ = 0;
+            intrusive_list<T>* bucket_ = nullptr;
+
+            template<typename, std::size_t, std::size_t>
+            friend class timer_wheel;
+    };
+
+    /**
+     * A hierarchical timing wheel whose slots are intrusive lists of timers.
+     *
+     * T must derive from timer_wheel_node<T>. Every level holds 2^SlotBits slots and
+     * covers SlotBits more bits of the tick counter than the level below it. Timers that
+     * are further away than the wheel can represent wait on an overflow list until the
+     * top level wraps around.
+     *
+     * Scheduling and cancelling are O(1). Expiring a slot moves the whole slot out with a
+     * single splice. All lists are created in the constructor, so the wheel never
+     * allocates afterwards.
+     */
+    template<typename T, std::size_t Levels = 4, std::size_t SlotBits = 8>
+    class timer_wheel {
+
+        static_assert(Levels > 0 && SlotBits > 0);
+        static_assert(Levels * SlotBits < 64, "The wheel must not cover the whole tick range");
+
+        public:
+
+            using size_type = std::size_t;
+            using value_type = T;
+            using reference = value_type&;
+            using tick_type = std::uint64_t;
+            using node_type = timer_wheel_node<value_type>;
+
+            static constexpr size_type slot_count = size_type{1} << SlotBits;
+            static constexpr tick_type slot_mask = slot_count - 1;
+
+            explicit timer_wheel(tick_type now = 0)
+                : now_(now) {}
+
+            timer_wheel(const timer_wheel&) = delete;
+            timer_wheel& operator=(const timer_wheel&) = delete;
+
+            /**
+             * Arms a timer. A timer that is already scheduled is moved to its new expiry.
+             *
+             * @param timer The timer to schedule.
+             * @param expiry The tick to fire on. Ticks that have already passed fire on the next advance.
+             */
+            void schedule(reference timer, tick_type expiry)
+            {
+                node_type& node = timer;
+
+                if (node.is_scheduled())
+                    unlink(timer);
+                else
+                    ++size_;
+
+                node.expiry_ = expiry;
+                link(timer, expiry > now_ ? expiry : now_ + 1);
+            }
+
+            /**
+             * Disarms a timer.
+             *
+             * @param timer The timer to cancel.
+             * @returns true if the timer was scheduled.
+             */
+            bool cancel(reference timer)
+            {
+                if (!static_cast<node_type&>(timer).is_scheduled())
+                    return false;
+
+                unlink(timer);
+                --size_;
+                return true;
+            }
+
+            /**
+             * Moves time forward, firing every timer whose expiry has been reached.
+             * The callback may schedule or cancel timers, but must not advance the wheel.
+             *
+             * @param target The tick to advance to.
+             * @param on_expire Invoked with a reference to each timer as it fires.
+             * @returns the number of timers that fired.
+             */
+            template<typename Callback>
+            size_type advance_to(tick_type target, Callback&& on_expire)
+            {
+                size_type fired = 0;
+
+                while (now_ < target) {
+
+                    if (size_ == 0) {
+                        now_ = target;
+                        break;
+                    }
+
+                    ++now_;
+                    cascade();
+
+                    expired_.splice(expired_.end(), wheel_[0][now_ & slot_mask]);
+                    while (!expired_.empty()) {
+
+                        reference timer = expired_.front();
+                        expired_.pop_front();
+                        static_cast<node_type&>(timer).bucket_ = nullptr;
+                        --size_;
+                        ++fired;
+                        on_expire(timer);
+                    }
+                }
+
+                return fired;
+            }
+
+            /**
+             * Moves time forward by the given number of ticks.
+             * @see advance_to
+             */
+            template<typename Callback>
+            size_type advance(tick_type ticks, Callback&& on_expire)
+            {
+                return advance_to(now_ + ticks, std::forward<Callback>(on_expire));
+            }
+
+            /**
+             * The last tick that has been processed.
+             */
+            tick_type now() const { return now_; }
+
+            /**
+             * Gets the number of timers waiting to fire.
+             */
+            size_type size() const { return size_; }
+
+            /**
+             * Are there no timers waiting to fire?
+             */
+            bool empty() const { return size_ == 0; }
+
+        private:
+
+            static constexpr tick_type level_shift(size_type level)
+            {
+                return static_cast<tick_type>(level * SlotBits);
+            }
+
+            void link(reference timer, tick_type when)
+            {
+                intrusive_list<T>* bucket = &overflow_;
+
+                for (size_type level = 0; level < Levels; ++level) {
+
+                    if (((when ^ now_) >> level_shift(level + 1)) == 0) {
+                        bucket = &wheel_[level][(when >> level_shift(level)) & slot_mask];
+                        break;
+                    }
+                }
+
+                bucket->push_back(timer);
+                static_cast<node_type&>(timer).bucket_ = bucket;
+            }
+
+            void unlink(reference timer)
+            {
+                node_type& node = timer;
+
+                node.bucket_->remove(timer);
+                node.bucket_ = nullptr;
+            }
+
+            /**
+             * Redistributes the slots of the upper levels that now_ has just entered, from
+             * the top down so that a timer may fall through several levels in one tick.
+             */
+            void cascade()
+            {
+                if ((now_ & slot_mask) != 0)
+                    return;
+
+                if ((now_ >> level_shift(Levels)) << level_shift(Levels) == now_)
+                    relink(overflow_);
+
+                for (size_type level = Levels - 1; level > 0; --level) {
+
+                    const tick_type below = now_ & ((tick_type{1} << level_shift(level)) - 1);
+                    if (below == 0)
+                        relink(wheel_[level][(now_ >> level_shift(level)) & slot_mask]);
+                }
+            }
+
+            void relink(intrusive_list<T>& bucket)
+            {
+                pending_.splice(pending_.end(), bucket);
+                while (!pending_.empty()) {
+
+                    reference timer = pending_.front();
+                    const tick_type expiry = static_cast<node_type&>(timer).expiry_;
+
+                    pending_.pop_front();
+                    link(timer, expiry > now_ ? expiry : now_);
+                }
+            }
+
+            tick_type now_;
+            size_type size_ = 0;
+            std::array<std::array<intrusive_list<T>, slot_count>, Levels> wheel_;
+            intrusive_list<T> overflow_;
+            intrusive_list<T> pending_;
+            intrusive_list<T> expired_;
+    };
+
+}  // namespace mcl
@@ -0,0 +1,506 @@
+// This file is part of the mcl project.
+// Copyright (c) 2022 merryhime
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "assert.hpp"
+#include "intrusive_list.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#    include <immintrin.h>
+#endif
+
+namespace mcl {
+
+    /**
+     * A lock that does nothing, for primitives that are only used from one thread.
+     */
+    class null_lock {
+
+        public:
+
+            void lock() noexcept {}
+            void unlock() noexcept {}
+    };
+
+    /**
+     * A test-and-test-and-set spinlock. The critical sections it guards are a handful
+     * of pointer writes, so spinning is cheaper than parking the thread.
+     */
+    class spin_lock {
+
+        public:
+
+            void lock() noexcept
+            {
+                while (locked.exchange(true, std::memory_order_acquire)) {
+
+                    while (locked.load(std::memory_order_relaxed)) {
+        #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+                        _mm_pause();
+        #endif
+                    }
+                }
+            }
+
+            void unlock() noexcept
+            {
+                locked.store(false, std::memory_order_release);
+            }
+
+        private:
+
+            std::atomic<bool> locked{false};
+    };
+
+    template<typename Lock>
+    class basic_wait_queue;
+
+    template<typename Lock>
+    class basic_async_mutex;
+
+    template<typename Lock>
+    class basic_async_event;
+
+    /**
+     * The part of an awaiter that is linked into a wait queue while its coroutine is
+     * suspended. It lives in the coroutine frame, so parking a coroutine never allocates.
+     */
+    class wait_queue_awaiter : public intrusive_list_node<wait_queue_awaiter> {
+
+        protected:
+
+            std::coroutine_handle<> handle;
+
+            template<typename Lock>
+            friend class basic_wait_queue;
+
+            template<typename Lock>
+            friend class basic_async_mutex;
+
+            friend class resume_queue;
+    };
+
+    /**
+     * Resumes woken coroutines on the calling thread.
+     *
+     * Only the outermost call on a thread resumes anything. A coroutine that wakes
+     * another one while it runs, such as an async_mutex owner unlocking, only queues it,
+     * and it is resumed once the waking coroutine suspends or finishes. A chain of
+     * hand-offs through a long queue therefore runs as a loop instead of growing the
+     * stack by a frame per waiter.
+     */
+    class resume_queue {
+
+        public:
+
+            static void resume(wait_queue_awaiter& waiter)
+            {
+                thread_local intrusive_list<wait_queue_awaiter> pending;
+                thread_local bool running = false;
+
+                pending.push_back(waiter);
+                if (running)
+                    return;
+
+                struct guard {
+
+                    ~guard() { running = false; }
+                } reset;
+
+                running = true;
+                while (!pending.empty()) {
+
+                    wait_queue_awaiter& next = pending.front();
+                    pending.pop_front();
+                    next.handle.resume();
+                }
+            }
+    };
+
+    /**
+     * A list of suspended coroutines.
+     *
+     * Waking removes a coroutine from the list in O(1) and resumes it on the calling
+     * thread through resume_queue. The lock is only held while the list is modified,
+     * never while a coroutine runs, so woken coroutines may freely wait on or notify
+     * the same queue.
+     *
+     * @tparam Lock null_lock for single threaded use, spin_lock to share between threads.
+     */
+    template<typename Lock>
+    class basic_wait_queue {
+
+        public:
+
+            class awaiter : public wait_queue_awaiter {
+
+                public:
+
+                    explicit awaiter(basic_wait_queue& queue)
+                        : queue(queue) {}
+
+                    bool await_ready() const noexcept { return false; }
+
+                    void await_suspend(std::coroutine_handle<> coroutine) noexcept
+                    {
+                        handle = coroutine;
+                        queue.park(*this);
+                    }
+
+                    void await_resume() const noexcept {}
+
+                private:
+
+                    basic_wait_queue& queue;
+            };
+
+            template<typename Predicate>
+            class predicate_awaiter : public wait_queue_awaiter {
+
+                public:
+
+                    predicate_awaiter(basic_wait_queue& queue, Predicate ready)
+                        : queue(queue), ready(std::move(ready)) {}
+
+                    bool await_ready() const noexcept { return false; }
+
+                    bool await_suspend(std::coroutine_handle<> coroutine) noexcept
+                    {
+                        handle = coroutine;
+                        return queue.park_unless(*this, ready);
+                    }
+
+                    void await_resume() const noexcept {}
+
+                private:
+
+                    basic_wait_queue& queue;
+                    Predicate ready;
+            };
+
+            basic_wait_queue() = default;
+            basic_wait_queue(const basic_wait_queue&) = delete;
+            basic_wait_queue& operator=(const basic_wait_queue&) = delete;
+
+            ~basic_wait_queue()
+            {
+                DEBUG_ASSERT(waiters.empty() && woken.empty());
+            }
+
+            /**
+             * Suspends the awaiting coroutine until it is notified.
+             */
+            awaiter wait() noexcept
+            {
+                return awaiter{*this};
+            }
+
+            /**
+             * Suspends the awaiting coroutine until it is notified, unless the condition
+             * already holds. The condition is checked under the queue lock, so a notifier
+             * that makes it true before calling notify_one or notify_all cannot be missed.
+             */
+            template<typename Predicate>
+            predicate_awaiter<std::decay_t<Predicate>> wait(Predicate&& ready)
+            {
+                return {*this, std::forward<Predicate>(ready)};
+            }
+
+            /**
+             * Resumes the coroutine that has been waiting the longest. Called from inside a
+             * coroutine that is being resumed, the woken one runs once the caller suspends.
+             * @returns true if a coroutine was woken.
+             */
+            bool notify_one()
+            {
+                lock.lock();
+                if (waiters.empty()) {
+                    lock.unlock();
+                    return false;
+                }
+
+                wait_queue_awaiter& next = waiters.front();
+                waiters.pop_front();
+                lock.unlock();
+
+                resume_queue::resume(next);
+                return true;
+            }
+
+            /**
+             * Resumes every coroutine that is waiting at the time of the call. Coroutines
+             * that start waiting while these are being resumed stay suspended.
+             * @returns the number of coroutines resumed by this call.
+             */
+            std::size_t notify_all()
+            {
+                lock.lock();
+                woken.splice(woken.end(), waiters);
+                lock.unlock();
+
+                return drain();
+            }
+
+            /**
+             * Is no coroutine waiting on this queue?
+             */
+            bool empty()
+            {
+                lock.lock();
+                const bool result = waiters.empty();
+                lock.unlock();
+                return result;
+            }
+
+        private:
+
+            void park(wait_queue_awaiter& waiter) noexcept
+            {
+                lock.lock();
+                waiters.push_back(waiter);
+                lock.unlock();
+            }
+
+            /**
+             * Parks the waiter unless the condition already holds, checked under the lock.
+             * @returns false if the waiter should not suspend.
+             */
+            template<typename Predicate>
+            bool park_unless(wait_queue_awaiter& waiter, Predicate&& ready) noexcept
+            {
+                lock.lock();
+                if (ready()) {
+                    lock.unlock();
+                    return false;
+                }
+
+                waiters.push_back(waiter);
+                lock.unlock();
+                return true;
+            }
+
+            /**
+             * Takes the longest waiting coroutine off the queue if there is one, otherwise
+             * runs the given action, as a single step under the lock.
+             */
+            template<typename Otherwise>
+            wait_queue_awaiter* pop_or(Otherwise&& otherwise) noexcept
+            {
+                lock.lock();
+                if (waiters.empty()) {
+                    otherwise();
+                    lock.unlock();
+                    return nullptr;
+                }
+
+                wait_queue_awaiter& next = waiters.front();
+                waiters.pop_front();
+                lock.unlock();
+                return &next;
+            }
+
+            template<typename Action>
+            std::size_t notify_all_after(Action&& action)
+            {
+                lock.lock();
+                action();
+                woken.splice(woken.end(), waiters);
+                lock.unlock();
+
+                return drain();
+            }
+
+            /**
+             * Resumes the coroutines taken off by notify_all. They are popped one at a time,
+             * so concurrent callers simply share the work.
+             */
+            std::size_t drain()
+            {
+                std::size_t resumed = 0;
+
+                while (true) {
+
+                    lock.lock();
+                    if (woken.empty()) {
+                        lock.unlock();
+                        return resumed;
+                    }
+
+                    wait_queue_awaiter& next = woken.front();
+                    woken.pop_front();
+                    lock.unlock();
+
+                    resume_queue::resume(next);
+                    ++resumed;
+                }
+            }
+
+            Lock lock;
+            intrusive_list<wait_queue_awaiter> waiters;
+            intrusive_list<wait_queue_awaiter> woken;
+
+            friend class basic_async_mutex<Lock>;
+            friend class basic_async_event<Lock>;
+    };
+
+    /**
+     * A mutex that suspends the awaiting coroutine instead of blocking the thread.
+     * Unlocking hands ownership directly to the next waiter, in FIFO order.
+     */
+    template<typename Lock>
+    class basic_async_mutex {
+
+        public:
+
+            class awaiter : public wait_queue_awaiter {
+
+                public:
+
+                    explicit awaiter(basic_async_mutex& mutex)
+                        : mutex(mutex) {}
+
+                    bool await_ready() noexcept { return mutex.try_lock(); }
+
+                    bool await_suspend(std::coroutine_handle<> coroutine) noexcept
+                    {
+                        handle = coroutine;
+                        return mutex.queue.park_unless(*this, [this] { return mutex.try_lock(); });
+                    }
+
+                    void await_resume() const noexcept {}
+
+                private:
+
+                    basic_async_mutex& mutex;
+            };
+
+            basic_async_mutex() = default;
+            basic_async_mutex(const basic_async_mutex&) = delete;
+            basic_async_mutex& operator=(const basic_async_mutex&) = delete;
+
+            /**
+             * Acquires the mutex, suspending until it is available.
+             */
+            awaiter lock() noexcept
+            {
+                return awaiter{*this};
+            }
+
+            /**
+             * Acquires the mutex if nobody holds it.
+             * @returns true if the mutex was acquired.
+             */
+            bool try_lock() noexcept
+            {
+                return !locked.exchange(true, std::memory_order_acquire);
+            }
+
+            /**
+             * Releases the mutex, resuming the next waiter as its new owner.
+             * @note Must only be called by the owner.
+             */
+            void unlock()
+            {
+                DEBUG_ASSERT(locked.load(std::memory_order_relaxed));
+
+                wait_queue_awaiter* next = queue.pop_or([this] { locked.store(false, std::memory_order_release); });
+                if (next)
+                    resume_queue::resume(*next);
+            }
+
+        private:
+
+            std::atomic<bool> locked{false};
+            basic_wait_queue<Lock> queue;
+    };
+
+    /**
+     * A manual-reset event. Coroutines awaiting an event that is set continue without
+     * suspending; set() resumes every coroutine that is waiting.
+     */
+    template<typename Lock>
+    class basic_async_event {
+
+        public:
+
+            class awaiter : public wait_queue_awaiter {
+
+                public:
+
+                    explicit awaiter(basic_async_event& event)
+                        : event(event) {}
+
+                    bool await_ready() const noexcept { return event.is_set(); }
+
+                    bool await_suspend(std::coroutine_handle<> coroutine) noexcept
+                    {
+                        handle = coroutine;
+                        return event.queue.park_unless(*this, [this] { return event.is_set(); });
+                    }
+
+                    void await_resume() const noexcept {}
+
+                private:
+
+                    basic_async_event& event;
+            };
+
+            explicit basic_async_event(bool initially_set = false)
+                : set_(initially_set) {}
+
+            basic_async_event(const basic_async_event&) = delete;
+            basic_async_event& operator=(const basic_async_event&) = delete;
+
+            /**
+             * Suspends the awaiting coroutine until the event is set.
+             */
+            awaiter wait() noexcept
+            {
+                return awaiter{*this};
+            }
+
+            /**
+             * Sets the event and resumes every waiting coroutine.
+             * @returns the number of coroutines resumed by this call.
+             */
+            std::size_t set()
+            {
+                return queue.notify_all_after([this] { set_.store(true, std::memory_order_release); });
+            }
+
+            /**
+             * Clears the event so that later waits suspend again.
+             */
+            void reset() noexcept
+            {
+                set_.store(false, std::memory_order_release);
+            }
+
+            bool is_set() const noexcept
+            {
+                return set_.load(std::memory_order_acquire);
+            }
+
+        private:
+
+            std::atomic<bool> set_;
+            basic_wait_queue<Lock> queue;
+    };
+
+    using wait_queue = basic_wait_queue<null_lock>;
+    using async_mutex = basic_async_mutex<null_lock>;
+    using async_event = basic_async_event<null_lock>;
+
+    using concurrent_wait_queue = basic_wait_queue<spin_lock>;
+    using concurrent_async_mutex = basic_async_mutex<spin_lock>;
+    using concurrent_async_event = basic_async_event<spin_lock>;
+
+}  // namespace mcl
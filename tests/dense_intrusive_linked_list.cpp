@@ -80,7 +80,8 @@ TEST_F(DenseListTest, Erase) {
     list.push_front(root);
     list.push_back(node2);
     list.pop_back();
-    EXPECT_THROW(list[1], std::out_of_range); 
+    EXPECT_EQ(list[1].lvalue, 67);
+    EXPECT_THROW(list[2], std::out_of_range); 
 
 }
 
@@ -129,7 +130,8 @@ TEST_F(DenseListTest, Swap) {
     // Test swap
     list.push_front(root);
     list.swap(list2);
-    EXPECT_TRUE(list[0] == nullptr);
+    EXPECT_THROW(list[0], std::out_of_range);
+    EXPECT_EQ(list2[0].lvalue, 45);
 
 }
 
@@ -0,0 +1,526 @@
+#include <gtest/gtest.h>
+#include <../include/dense_list.hpp>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+template<typename List>
+class DenseSlotListTest : public ::testing::Test {
+
+    protected:
+        void TestBody() override { return; };
+
+        void SetUp() override {
+
+            return;
+        }
+
+        static std::vector<int> contents(const List& list) {
+
+            return std::vector<int>(list.begin(), list.end());
+        }
+};
+
+using DenseListTypes = ::testing::Types<
+    mlc::dense_list<int>,
+    mlc::dense_list<int, mlc::mapped_storage<mlc::dense_list_slot<int>>>,
+    mlc::dense_list<int, mlc::vector_storage<mlc::dense_list_slot<int>>, mlc::order_statistics_index>,
+    mlc::dense_list<int, mlc::cow_storage<mlc::dense_list_slot<int>, 64>>,
+    mlc::dense_list<int, mlc::vector_storage<mlc::cache_line_layout<>::slot<int>>>>;
+TYPED_TEST_SUITE(DenseSlotListTest, DenseListTypes);
+
+TYPED_TEST(DenseSlotListTest, PushAndPop) {
+
+    TypeParam list;
+
+    list.push_back(45);
+    list.push_back(67);
+    list.push_front(10);
+    EXPECT_EQ(this->contents(list), (std::vector<int>{10, 45, 67}));
+    EXPECT_EQ(list.front(), 10);
+    EXPECT_EQ(list.back(), 67);
+
+    list.pop_back();
+    EXPECT_EQ(this->contents(list), (std::vector<int>{10, 45}));
+    list.pop_front();
+    EXPECT_EQ(this->contents(list), (std::vector<int>{45}));
+    list.pop_front();
+    EXPECT_TRUE(list.empty());
+    EXPECT_THROW(list.front(), std::out_of_range);
+
+}
+
+TYPED_TEST(DenseSlotListTest, Positional) {
+
+    TypeParam list;
+
+    for (int i = 0; i < 10; ++i) list.push_back(i);
+    list.insert(0, 100);
+    list.insert(5, 200);
+    list.insert(12, 300);
+    EXPECT_EQ(list[0], 100);
+    EXPECT_EQ(list[5], 200);
+    EXPECT_EQ(list[12], 300);
+    EXPECT_THROW(list[13], std::out_of_range);
+
+    list.erase(5);
+    list.erase(0);
+    list.erase(10);
+    EXPECT_EQ(this->contents(list), (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    EXPECT_THROW(list.erase(10), std::out_of_range);
+
+}
+
+TYPED_TEST(DenseSlotListTest, Handles) {
+
+    TypeParam list;
+
+    auto a = list.push_back(1);
+    auto b = list.push_back(2);
+    auto c = list.push_back(3);
+    list.insert_before(b, 4);
+    list.remove(a);
+    EXPECT_EQ(this->contents(list), (std::vector<int>{4, 2, 3}));
+    EXPECT_EQ(list.next(b), c);
+    EXPECT_EQ(list.get(c), 3);
+
+    // Erased slots are reused
+    EXPECT_EQ(list.push_back(5), a);
+
+    std::vector<int> reversed(list.rbegin(), list.rend());
+    EXPECT_EQ(reversed, (std::vector<int>{5, 3, 2, 4}));
+
+}
+
+TYPED_TEST(DenseSlotListTest, Swap) {
+
+    TypeParam list;
+    TypeParam list2;
+
+    list.push_back(45);
+    list.swap(list2);
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(this->contents(list2), (std::vector<int>{45}));
+
+}
+
+TYPED_TEST(DenseSlotListTest, Move) {
+
+    TypeParam list;
+
+    for (int i = 0; i < 20; ++i) list.push_back(i);
+    list.erase(3);
+
+    TypeParam moved(std::move(list));
+    EXPECT_EQ(moved.size(), 19);
+    EXPECT_EQ(moved[3], 4);
+
+    // The moved-from list is empty and can be used again
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(list.begin(), list.end());
+    list.push_back(7);
+    list.push_front(6);
+    EXPECT_EQ(this->contents(list), (std::vector<int>{6, 7}));
+
+    TypeParam assigned;
+    assigned.push_back(1);
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned.size(), 19);
+    EXPECT_EQ(assigned.back(), 19);
+    EXPECT_TRUE(moved.empty());
+    moved.push_back(5);
+    EXPECT_EQ(this->contents(moved), (std::vector<int>{5}));
+
+}
+
+TYPED_TEST(DenseSlotListTest, Clone) {
+
+    TypeParam list;
+
+    for (int i = 0; i < 100; ++i) list.push_back(i);
+    list.erase(50);
+    auto copy = list.clone();
+
+    list.pop_front();
+    list.edit(list.head()) = -1;
+    copy.push_back(100);
+
+    EXPECT_EQ(copy.size(), 100);
+    EXPECT_EQ(copy[0], 0);
+    EXPECT_EQ(copy[1], 1);
+    EXPECT_EQ(copy[50], 51);
+    EXPECT_EQ(copy.back(), 100);
+    EXPECT_EQ(list.front(), -1);
+
+}
+
+TEST(DenseListStorage, CloneNonTrivialValues) {
+
+    mlc::dense_list<std::string, mlc::mapped_storage<mlc::dense_list_slot<std::string>>> list;
+
+    list.push_back(std::string(100, 'a'));
+    list.push_back("b");
+    auto copy = list.clone();
+    list.front().clear();
+
+    EXPECT_EQ(copy.front(), std::string(100, 'a'));
+    EXPECT_EQ(copy.back(), "b");
+
+}
+
+TEST(DenseListStorage, SnapshotSharesUntouchedChunks) {
+
+    using cow_list = mlc::dense_list<int, mlc::cow_storage<mlc::dense_list_slot<int>, 1024>>;
+    cow_list list;
+
+    for (int i = 0; i < 10000; ++i) list.push_back(i);
+    auto snapshot = list.snapshot();
+    const auto chunks = list.get_storage().shared_chunks();
+    EXPECT_GT(chunks, 10);
+
+    // Only the chunks holding the edited slots are copied
+    list.edit(list.head()) = -1;
+    list.pop_back();
+    EXPECT_EQ(list.get_storage().shared_chunks(), chunks - 2);
+
+    EXPECT_EQ(snapshot->front(), 0);
+    EXPECT_EQ(snapshot->back(), 9999);
+    EXPECT_EQ(snapshot->size(), 10000);
+    EXPECT_EQ(list.front(), -1);
+    EXPECT_EQ(list.size(), 9999);
+
+}
+
+TEST(DenseListStorage, SnapshotReadersOnOtherThreads) {
+
+    using cow_list = mlc::dense_list<int, mlc::cow_storage<mlc::dense_list_slot<int>, 256>>;
+    cow_list list;
+    for (int i = 0; i < 1000; ++i) list.push_back(0);
+
+    std::shared_ptr<const cow_list> published = list.snapshot();
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+
+    // Every snapshot holds one value everywhere; a reader must never see two
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t)
+        readers.emplace_back([&] {
+            while (!done.load()) {
+
+                auto snapshot = std::atomic_load(&published);
+                const int first = snapshot->front();
+                for (int value : *snapshot) if (value != first) torn.fetch_add(1);
+            }
+        });
+
+    for (int version = 1; version <= 200; ++version) {
+
+        for (auto handle = list.head(); handle != cow_list::npos; handle = list.next(handle)) list.edit(handle) = version;
+        std::atomic_store(&published, list.snapshot());
+    }
+
+    done.store(true);
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(torn.load(), 0);
+
+}
+
+TEST(DenseListLayout, CacheLineSlots) {
+
+    struct twenty { char bytes[20]; };
+    struct hundred { char bytes[100]; };
+
+    static_assert(sizeof(mlc::dense_list_slot<int>) == 12);
+    static_assert(sizeof(mlc::cache_line_layout<>::slot<int>) == 16);
+    static_assert(sizeof(mlc::cache_line_layout<>::slot<twenty>) == 32);
+    static_assert(sizeof(mlc::cache_line_layout<>::slot<hundred>) == 128);
+    static_assert(alignof(mlc::cache_line_layout<>::slot<hundred>) == 64);
+
+    mlc::dense_list<twenty, mlc::vector_storage<mlc::cache_line_layout<>::slot<twenty>>> list;
+    for (int i = 0; i < 100; ++i) list.push_back(twenty{});
+
+    // No slot straddles a cache line
+    for (auto it = list.begin(); it != list.end(); ++it) {
+
+        const auto address = reinterpret_cast<std::uintptr_t>(&*it);
+        EXPECT_EQ(address / 64, (address + sizeof(mlc::cache_line_layout<>::slot<twenty>) - 1) / 64);
+    }
+
+}
+
+TEST(DenseListLayout, HotColdSplit) {
+
+    using layout = mlc::hot_cold_layout<std::string>;
+    mlc::dense_list<int, mlc::vector_storage<layout::slot<int>>> list;
+
+    static_assert(sizeof(layout::slot<int>) == sizeof(mlc::dense_list_slot<int>));
+
+    auto a = list.push_back(1);
+    auto b = list.push_back(2);
+    list.cold(a) = "first";
+    list.cold(b) = "second";
+
+    // The cold array grows along with the slots
+    for (int i = 0; i < 1000; ++i) list.push_back(i);
+    EXPECT_EQ(list.cold(a), "first");
+    EXPECT_EQ(list.cold(b), "second");
+
+    auto copy = list.clone();
+    list.remove(a);
+    EXPECT_TRUE(list.cold(a).empty());
+    EXPECT_EQ(copy.cold(a), "first");
+
+    // A reused slot starts with an empty cold part
+    EXPECT_EQ(list.push_front(3), a);
+    EXPECT_TRUE(list.cold(a).empty());
+
+}
+
+TEST(DenseListLayout, HotColdSplitTrivialCold) {
+
+    using layout = mlc::hot_cold_layout<std::uint64_t>;
+    mlc::dense_list<int, mlc::vector_storage<layout::slot<int>>> list;
+
+    list.push_back(1);
+    auto b = list.push_back(2);
+    list.cold(b) = 42;
+
+    // A reused slot starts with a zero cold part too
+    list.remove(b);
+    EXPECT_EQ(list.push_back(3), b);
+    EXPECT_EQ(list.cold(b), 0);
+
+}
+
+TEST(DenseListLayout, HotColdMappedOptions) {
+
+    using layout = mlc::hot_cold_layout<std::uint64_t>;
+    using mapped = mlc::mapped_storage<layout::slot<std::uint32_t>>;
+
+    mlc::mapped_storage_options options;
+    options.reserve_bytes = std::size_t{1} << 24;
+    options.huge_pages = false;
+    mlc::dense_list<std::uint32_t, mapped> list{mapped(options)};
+
+    // The cold array is reserved with the hot array's options, for as many elements
+    const auto& cold = list.get_cold_storage();
+    EXPECT_FALSE(cold.huge_pages());
+    EXPECT_GE(cold.max_capacity(), list.get_storage().max_capacity());
+    EXPECT_LE(cold.max_capacity() * sizeof(std::uint64_t), options.reserve_bytes);
+
+    for (std::uint32_t i = 0; i < 1000; ++i) list.edit_cold(list.push_back(i)) = i * 10;
+    EXPECT_EQ(list.cold(list.tail()), 9990);
+
+}
+
+TEST(DenseListLayout, HotColdSnapshot) {
+
+    using layout = mlc::hot_cold_layout<std::uint64_t, mlc::cache_line_layout<>>;
+    using cow_list = mlc::dense_list<std::uint32_t, mlc::cow_storage<layout::slot<std::uint32_t>, 256>>;
+    cow_list list;
+
+    auto handle = list.push_back(7);
+    list.edit_cold(handle) = 70;
+    auto snapshot = list.snapshot();
+    list.edit_cold(handle) = 71;
+
+    EXPECT_EQ(snapshot->cold(handle), 70);
+    EXPECT_EQ(list.cold(handle), 71);
+
+}
+
+TEST(DenseListStorage, ReadingKeepsChunksShared) {
+
+    using cow_list = mlc::dense_list<int, mlc::cow_storage<mlc::dense_list_slot<int>, 1024>>;
+    cow_list list;
+
+    for (int i = 0; i < 10000; ++i) list.push_back(i);
+    auto snapshot = list.snapshot();
+    const auto chunks = list.get_storage().shared_chunks();
+
+    // Reads through the non-const list copy nothing
+    long sum = 0;
+    for (int value : list) sum += value;
+    sum += list.front() + list.back() + list[5000] + list.get(list.head());
+    EXPECT_EQ(sum, 49995000 + 9999 + 5000);
+    EXPECT_EQ(list.get_storage().shared_chunks(), chunks);
+
+    list.edit(list.head()) = -1;
+    EXPECT_EQ(list.get_storage().shared_chunks(), chunks - 1);
+    EXPECT_EQ(snapshot->front(), 0);
+
+}
+
+TEST(DenseListLayout, HotColdMappedSmallCold) {
+
+    using layout = mlc::hot_cold_layout<std::uint8_t>;
+    using mapped = mlc::mapped_storage<layout::slot<std::uint64_t>>;
+
+    mlc::mapped_storage_options options;
+    options.reserve_bytes = std::size_t{16} << 20;
+    mlc::dense_list<std::uint64_t, mapped> list{mapped(options)};
+
+    // A cold part much smaller than the hot slot still gets a whole reservation
+    const auto& cold = list.get_cold_storage();
+    EXPECT_GE(cold.max_capacity(), list.get_storage().max_capacity());
+    EXPECT_GE(cold.max_capacity() * sizeof(std::uint8_t), mapped::commit_granularity);
+
+    for (std::uint64_t i = 0; i < 1000; ++i) list.edit_cold(list.push_back(i)) = static_cast<std::uint8_t>(i);
+    EXPECT_EQ(list.cold(list.tail()), static_cast<std::uint8_t>(999));
+
+}
+
+TEST(DenseListStorage, MappedGrowthKeepsAddresses) {
+
+    mlc::dense_list<std::string, mlc::mapped_storage<mlc::dense_list_slot<std::string>>> list;
+
+    auto first = list.push_back("first");
+    const std::string* address = &list.get(first);
+
+    for (int i = 0; i < 200000; ++i) list.push_back(std::to_string(i));
+    EXPECT_GT(list.capacity(), 200000);
+    EXPECT_EQ(&list.get(first), address);
+    EXPECT_EQ(*address, "first");
+    EXPECT_EQ(list.back(), "199999");
+
+}
+
+TEST(DenseListStorage, MappedFallsBack) {
+
+    mlc::mapped_storage_options options;
+    options.reserve_bytes = std::size_t{1} << 24;
+    options.numa_node = 0;
+    mlc::dense_list<int, mlc::mapped_storage<mlc::dense_list_slot<int>>> list{mlc::mapped_storage<mlc::dense_list_slot<int>>(options)};
+
+    // Whether or not huge pages and NUMA binding were granted, the list works
+    for (int i = 0; i < 1000; ++i) list.push_back(i);
+    EXPECT_EQ(list[999], 999);
+
+    // The reservation is a hard limit
+    EXPECT_THROW(list.reserve(list.get_storage().max_capacity() + 1), std::bad_alloc);
+
+}
+
+TEST(DenseListStorage, MappedSmallReservation) {
+
+    mlc::mapped_storage_options options;
+    options.reserve_bytes = std::size_t{1} << 20;
+    mlc::dense_list<int, mlc::mapped_storage<mlc::dense_list_slot<int>>> list{mlc::mapped_storage<mlc::dense_list_slot<int>>(options)};
+
+    // Less than one commit piece is rounded up to a whole one
+    EXPECT_EQ(list.get_storage().max_capacity(), mlc::mapped_storage<mlc::dense_list_slot<int>>::commit_granularity / sizeof(mlc::dense_list_slot<int>));
+    for (int i = 0; i < 1000; ++i) list.push_back(i);
+    EXPECT_EQ(list[999], 999);
+
+}
+
+TEST(DenseListIndex, MatchesReferenceModel) {
+
+    mlc::dense_list<int, mlc::vector_storage<mlc::dense_list_slot<int>>, mlc::order_statistics_index> list;
+    std::vector<int> model;
+    std::vector<mlc::dense_list<int>::index_type> handles;
+    std::mt19937 rng(7);
+
+    for (int step = 0; step < 20000; ++step) {
+
+        const auto size = static_cast<std::uint32_t>(model.size());
+        const int operation = static_cast<int>(rng() % 6);
+
+        if (operation == 0 || size == 0) {
+
+            handles.insert(handles.begin(), list.push_front(step));
+            model.insert(model.begin(), step);
+        }
+        else if (operation == 1) {
+
+            handles.push_back(list.push_back(step));
+            model.push_back(step);
+        }
+        else if (operation == 2) {
+
+            const auto position = static_cast<std::uint32_t>(rng() % (size + 1));
+            handles.insert(handles.begin() + position, list.insert(position, step));
+            model.insert(model.begin() + position, step);
+        }
+        else if (operation == 3) {
+
+            const auto position = static_cast<std::uint32_t>(rng() % size);
+            list.erase(position);
+            handles.erase(handles.begin() + position);
+            model.erase(model.begin() + position);
+        }
+        else if (operation == 4) {
+
+            list.pop_front();
+            handles.erase(handles.begin());
+            model.erase(model.begin());
+        }
+        else {
+
+            list.pop_back();
+            handles.pop_back();
+            model.pop_back();
+        }
+
+        ASSERT_EQ(list.size(), model.size());
+        if (!model.empty()) {
+
+            const auto position = static_cast<std::uint32_t>(rng() % model.size());
+            ASSERT_EQ(list[position], model[position]);
+            ASSERT_EQ(list.nth(position), handles[position]);
+            ASSERT_EQ(list.position_of(handles[position]), position);
+        }
+    }
+
+    EXPECT_EQ(std::vector<int>(list.begin(), list.end()), model);
+
+    // Used as a queue in both directions, slots leave the end buffers from the side
+    // they did not enter, and now and then from the treap left over from above
+    for (int step = 0; step < 20000; ++step) {
+
+        if (step % 2000 < 1000) {
+
+            handles.push_back(list.push_back(step));
+            model.push_back(step);
+            if (step % 3 != 0) {
+
+                list.pop_front();
+                handles.erase(handles.begin());
+                model.erase(model.begin());
+            }
+        }
+        else {
+
+            handles.insert(handles.begin(), list.push_front(step));
+            model.insert(model.begin(), step);
+            if (step % 3 != 0) {
+
+                list.pop_back();
+                handles.pop_back();
+                model.pop_back();
+            }
+        }
+
+        ASSERT_EQ(list.size(), model.size());
+        const auto position = static_cast<std::uint32_t>(rng() % model.size());
+        ASSERT_EQ(list[position], model[position]);
+        ASSERT_EQ(list.position_of(handles[position]), position);
+        ASSERT_EQ(list.position_of(handles.front()), 0);
+        ASSERT_EQ(list.position_of(handles.back()), model.size() - 1);
+    }
+
+    EXPECT_EQ(std::vector<int>(list.begin(), list.end()), model);
+
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
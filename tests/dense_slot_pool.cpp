@@ -0,0 +1,138 @@
+// assert.hpp defines its own ASSERT_FALSE, so keep gtest's under the name GTEST_ASSERT_FALSE
+#define GTEST_DONT_DEFINE_ASSERT_FALSE 1
+#include <gtest/gtest.h>
+#include <../include/dense_slot_pool.hpp>
+
+#include <atomic>
+#include <new>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+
+class DenseSlotPoolTest : public ::testing::Test {
+
+    protected:
+        void TestBody() override { return; };
+
+        void SetUp() override {
+
+            return;
+        }
+};
+
+TEST_F(DenseSlotPoolTest, InsertAndErase) {
+
+    mlc::dense_slot_pool<int> pool(256);
+    mlc::dense_slot_pool<int>::thread_cache cache(pool);
+
+    auto first = cache.insert(45);
+    auto second = cache.insert(67);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(pool[first], 45);
+    EXPECT_EQ(pool[second], 67);
+
+    // A freed slot is the next one handed out
+    cache.erase(first);
+    EXPECT_EQ(cache.insert(10), first);
+    EXPECT_EQ(pool[first], 10);
+
+}
+
+TEST_F(DenseSlotPoolTest, MagazinesOwnTheirCacheLines) {
+
+    static_assert(alignof(mlc::slot_magazine) == 64);
+    static_assert(sizeof(mlc::slot_magazine) % 64 == 0);
+
+    mlc::dense_slot_pool<int> pool(1000);
+    mlc::dense_slot_pool<int>::thread_cache cache(pool);
+    for (int i = 0; i < 1000; ++i) cache.allocate();
+
+}
+
+TEST_F(DenseSlotPoolTest, Exhaustion) {
+
+    mlc::dense_slot_pool<int> pool(200);
+    mlc::dense_slot_pool<int>::thread_cache cache(pool);
+    std::set<mlc::dense_slot_pool<int>::index_type> taken;
+
+    for (int i = 0; i < 200; ++i) taken.insert(cache.allocate());
+    EXPECT_EQ(taken.size(), 200);
+    EXPECT_LT(*taken.rbegin(), 200);
+    EXPECT_THROW(cache.allocate(), std::bad_alloc);
+
+    // Slots flow back through the depot to another cache, except for the ones the
+    // first cache still holds in its own magazines
+    for (auto index : taken) cache.deallocate(index);
+    mlc::dense_slot_pool<int>::thread_cache other(pool);
+    std::set<mlc::dense_slot_pool<int>::index_type> moved;
+
+    for (int i = 0; i < 128; ++i) moved.insert(other.allocate());
+    EXPECT_EQ(moved.size(), 128);
+    EXPECT_THROW(other.allocate(), std::bad_alloc);
+
+    cache.flush();
+    for (int i = 0; i < 72; ++i) moved.insert(other.allocate());
+    EXPECT_EQ(moved, taken);
+    EXPECT_THROW(other.allocate(), std::bad_alloc);
+
+}
+
+TEST_F(DenseSlotPoolTest, CacheReturnsSlotsOnDestruction) {
+
+    mlc::dense_slot_pool<int> pool(64);
+
+    {
+        mlc::dense_slot_pool<int>::thread_cache cache(pool);
+        for (int i = 0; i < 64; ++i) cache.allocate();
+        for (int i = 0; i < 64; ++i) cache.deallocate(static_cast<mlc::dense_slot_pool<int>::index_type>(i));
+    }
+
+    mlc::dense_slot_pool<int>::thread_cache cache(pool);
+    for (int i = 0; i < 64; ++i) cache.allocate();
+    EXPECT_THROW(cache.allocate(), std::bad_alloc);
+
+}
+
+TEST_F(DenseSlotPoolTest, ConcurrentOwnership) {
+
+    constexpr int threads = 8;
+    constexpr int live = 300;
+    constexpr int rounds = 2000;
+    mlc::dense_slot_pool<int> pool(threads * (live + 2 * mlc::slot_magazine::capacity));
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+
+            mlc::dense_slot_pool<int>::thread_cache cache(pool);
+            std::vector<mlc::dense_slot_pool<int>::index_type> held;
+
+            for (int round = 0; round < rounds; ++round) {
+
+                for (int i = 0; i < live; ++i) held.push_back(cache.insert(t));
+                for (auto index : held) if (pool[index] != t) errors.fetch_add(1);
+
+                // Free half of them, crossing magazine boundaries in both directions
+                for (int i = 0; i < live / 2; ++i) {
+
+                    cache.erase(held.back());
+                    held.pop_back();
+                }
+                for (auto index : held) cache.erase(index);
+                held.clear();
+            }
+        });
+    for (auto& worker : workers) worker.join();
+
+    EXPECT_EQ(errors.load(), 0);
+
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
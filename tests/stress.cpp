@@ -0,0 +1,476 @@
+// Differential stress harness for the list implementations.
+//
+// A seeded generator produces a long sequence of list operations drawn from an
+// operation-mix profile. The sequence is replayed against every engine:
+//
+//   verify  Each step is applied to all engines and to a std::list reference model, and
+//           the full contents of every engine are compared with the model after each step.
+//   time    Each engine replays the whole sequence on its own and the harness reports
+//           the throughput of every operation type, less the cost of the clock reads
+//           around each step, and of a replay that is only timed as a whole.
+//
+// Usage: stress [--seed N] [--ops N] [--profile NAME] [--mode verify|time] [--engine NAME]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dense_intrusive_linked_list.h"
+#include "dense_list.hpp"
+#include "intrusive_list.hpp"
+
+namespace {
+
+    enum class operation : std::uint8_t {
+        push_front,
+        push_back,
+        pop_front,
+        pop_back,
+        insert,
+        erase,
+        read,
+        count,
+    };
+
+    constexpr std::size_t operation_count = static_cast<std::size_t>(operation::count);
+
+    constexpr std::array<const char*, operation_count> operation_names = {
+        "push_front", "push_back", "pop_front", "pop_back", "insert", "erase", "read",
+    };
+
+    struct step {
+
+        operation op;
+        std::uint32_t position;
+        int value;
+    };
+
+    /**
+     * The relative weight of every operation, and the size the list hovers around. Once
+     * the list is larger than max_size only shrinking operations are drawn.
+     */
+    struct profile {
+
+        const char* name;
+        std::array<unsigned, operation_count> weights;
+        std::size_t max_size;
+    };
+
+    constexpr std::array<profile, 4> profiles = {{
+        {"mixed",      {2, 2, 1, 1, 2, 2, 2}, 512},
+        {"ends",       {4, 4, 3, 3, 0, 0, 1}, 1024},
+        {"positional", {0, 1, 0, 0, 4, 3, 4}, 256},
+        {"churn",      {0, 4, 0, 0, 0, 4, 1}, 2048},
+    }};
+
+    class engine {
+
+        public:
+
+            virtual ~engine() = default;
+
+            virtual const char* name() const = 0;
+            virtual void push_front(int value) = 0;
+            virtual void push_back(int value) = 0;
+            virtual void pop_front() = 0;
+            virtual void pop_back() = 0;
+            virtual void insert(std::uint32_t position, int value) = 0;
+            virtual void erase(std::uint32_t position) = 0;
+            virtual int read(std::uint32_t position) = 0;
+            virtual std::size_t size() = 0;
+            virtual std::vector<int> contents() = 0;
+
+            /**
+             * Applies one step. Reads are returned so that the optimiser keeps them.
+             */
+            int apply(const step& s) {
+
+                switch (s.op) {
+                case operation::push_front: push_front(s.value); return 0;
+                case operation::push_back: push_back(s.value); return 0;
+                case operation::pop_front: pop_front(); return 0;
+                case operation::pop_back: pop_back(); return 0;
+                case operation::insert: insert(s.position, s.value); return 0;
+                case operation::erase: erase(s.position); return 0;
+                case operation::read: return read(s.position);
+                default: return 0;
+                }
+            }
+    };
+
+    class std_list_engine final : public engine {
+
+        public:
+
+            const char* name() const override { return "std::list"; }
+            void push_front(int value) override { list.push_front(value); }
+            void push_back(int value) override { list.push_back(value); }
+            void pop_front() override { list.pop_front(); }
+            void pop_back() override { list.pop_back(); }
+            void insert(std::uint32_t position, int value) override { list.insert(std::next(list.begin(), position), value); }
+            void erase(std::uint32_t position) override { list.erase(std::next(list.begin(), position)); }
+            int read(std::uint32_t position) override { return *std::next(list.begin(), position); }
+            std::size_t size() override { return list.size(); }
+            std::vector<int> contents() override { return {list.begin(), list.end()}; }
+
+        private:
+
+            std::list<int> list;
+    };
+
+    class intrusive_dense_list_engine final : public engine {
+
+        public:
+
+            const char* name() const override { return "mlc::intrusive_dense_list"; }
+            void push_front(int value) override { list.push_front(node(value)); }
+            void push_back(int value) override { list.push_back(node(value)); }
+            void pop_front() override { list.pop_front(); }
+            void pop_back() override { list.pop_back(); }
+            void insert(std::uint32_t position, int value) override { list.insert(position, node(value)); }
+            void erase(std::uint32_t position) override { list.erase(position); }
+            int read(std::uint32_t position) override { return list[position].lvalue; }
+            std::size_t size() override { return list.size(); }
+
+            std::vector<int> contents() override {
+
+                std::vector<int> result;
+                for (std::uint32_t i = 0; i < list.size(); ++i) result.push_back(list[i].lvalue);
+                return result;
+            }
+
+        private:
+
+            static mlc::intrusive_dense_list_node<int> node(int value) {
+
+                mlc::intrusive_dense_list_node<int> result;
+                result.lvalue = value;
+                return result;
+            }
+
+            mlc::intrusive_dense_list<int> list;
+    };
+
+    struct stress_node : public mcl::intrusive_list_node<stress_node> {
+
+        int value = 0;
+    };
+
+    class intrusive_list_engine final : public engine {
+
+        public:
+
+            const char* name() const override { return "mcl::intrusive_list"; }
+            void push_front(int value) override { list.push_front(acquire(value)); ++count; }
+            void push_back(int value) override { list.push_back(acquire(value)); ++count; }
+            void pop_front() override { release(list.front()); list.pop_front(); --count; }
+            void pop_back() override { release(list.back()); list.pop_back(); --count; }
+
+            void insert(std::uint32_t position, int value) override {
+
+                list.insert(std::next(list.begin(), position), &acquire(value));
+                ++count;
+            }
+
+            void erase(std::uint32_t position) override {
+
+                auto it = std::next(list.begin(), position);
+                release(*it);
+                list.erase(it);
+                --count;
+            }
+
+            int read(std::uint32_t position) override { return std::next(list.begin(), position)->value; }
+            std::size_t size() override { return count; }
+
+            std::vector<int> contents() override {
+
+                std::vector<int> result;
+                for (const auto& node : list) result.push_back(node.value);
+                return result;
+            }
+
+        private:
+
+            stress_node& acquire(int value) {
+
+                stress_node* node;
+                if (free.empty()) node = &nodes.emplace_back();
+                else {
+                    node = free.back();
+                    free.pop_back();
+                }
+
+                node->value = value;
+                return *node;
+            }
+
+            void release(stress_node& node) {
+
+                free.push_back(&node);
+            }
+
+            std::deque<stress_node> nodes;
+            std::vector<stress_node*> free;
+            mcl::intrusive_list<stress_node> list;
+            std::size_t count = 0;
+    };
+
+    template<typename List>
+    class dense_list_engine final : public engine {
+
+        public:
+
+            explicit dense_list_engine(const char* label)
+                : label(label) {}
+
+            const char* name() const override { return label; }
+            void push_front(int value) override { list.push_front(value); }
+            void push_back(int value) override { list.push_back(value); }
+            void pop_front() override { list.pop_front(); }
+            void pop_back() override { list.pop_back(); }
+            void insert(std::uint32_t position, int value) override { list.insert(position, value); }
+            void erase(std::uint32_t position) override { list.erase(position); }
+            int read(std::uint32_t position) override { return list[position]; }
+            std::size_t size() override { return list.size(); }
+            std::vector<int> contents() override { return {list.cbegin(), list.cend()}; }
+
+        private:
+
+            const char* label;
+            List list;
+    };
+
+    std::vector<std::unique_ptr<engine>> make_engines(const char* only) {
+
+        std::vector<std::unique_ptr<engine>> engines;
+
+        engines.push_back(std::make_unique<intrusive_dense_list_engine>());
+        engines.push_back(std::make_unique<intrusive_list_engine>());
+        engines.push_back(std::make_unique<dense_list_engine<mlc::dense_list<int>>>("mlc::dense_list"));
+        engines.push_back(std::make_unique<dense_list_engine<mlc::dense_list<int, mlc::mapped_storage<mlc::dense_list_slot<int>>>>>("mlc::dense_list<mapped>"));
+        engines.push_back(std::make_unique<dense_list_engine<mlc::dense_list<int, mlc::vector_storage<mlc::dense_list_slot<int>>, mlc::order_statistics_index>>>("mlc::dense_list<indexed>"));
+        engines.push_back(std::make_unique<dense_list_engine<mlc::dense_list<int, mlc::cow_storage<mlc::dense_list_slot<int>>>>>("mlc::dense_list<cow>"));
+
+        if (only != nullptr) {
+
+            std::erase_if(engines, [&](const auto& e) { return std::strcmp(e->name(), only) != 0; });
+        }
+
+        return engines;
+    }
+
+    /**
+     * Draws the operation sequence. Only operations that are valid for the current size
+     * are drawn, so every engine can replay the sequence as it is.
+     */
+    std::vector<step> generate(const profile& mix, std::uint64_t seed, std::size_t ops) {
+
+        std::mt19937_64 rng(seed);
+        std::vector<step> steps;
+        std::size_t size = 0;
+
+        steps.reserve(ops);
+        while (steps.size() < ops) {
+
+            std::array<unsigned, operation_count> weights = mix.weights;
+            if (size == 0) {
+
+                for (auto op : {operation::pop_front, operation::pop_back, operation::erase, operation::read})
+                    weights[static_cast<std::size_t>(op)] = 0;
+            }
+            if (size >= mix.max_size) {
+
+                for (auto op : {operation::push_front, operation::push_back, operation::insert})
+                    weights[static_cast<std::size_t>(op)] = 0;
+            }
+
+            std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+            const auto op = static_cast<operation>(pick(rng));
+
+            step s{op, 0, static_cast<int>(rng() & 0x7fffffff)};
+            switch (op) {
+            case operation::push_front:
+            case operation::push_back: ++size; break;
+            case operation::pop_front:
+            case operation::pop_back: --size; break;
+            case operation::insert: s.position = static_cast<std::uint32_t>(rng() % (size + 1)); ++size; break;
+            case operation::erase: s.position = static_cast<std::uint32_t>(rng() % size); --size; break;
+            case operation::read: s.position = static_cast<std::uint32_t>(rng() % size); break;
+            default: break;
+            }
+
+            steps.push_back(s);
+        }
+
+        return steps;
+    }
+
+    void print_contents(const char* label, const std::vector<int>& values) {
+
+        std::fprintf(stderr, "  %-26s [", label);
+        for (std::size_t i = 0; i < values.size() && i < 16; ++i) std::fprintf(stderr, "%s%d", i ? ", " : "", values[i]);
+        std::fprintf(stderr, "%s] size %zu\n", values.size() > 16 ? ", ..." : "", values.size());
+    }
+
+    int verify(const std::vector<step>& steps, std::vector<std::unique_ptr<engine>>& engines) {
+
+        std_list_engine model;
+        std::vector<bool> failed(engines.size(), false);
+        std::size_t failures = 0;
+
+        for (std::size_t i = 0; i < steps.size(); ++i) {
+
+            const step& s = steps[i];
+            const int expected_read = model.apply(s);
+            const std::vector<int> expected = model.contents();
+
+            for (std::size_t e = 0; e < engines.size(); ++e) {
+
+                if (failed[e]) continue;
+
+                const int read = engines[e]->apply(s);
+                const std::vector<int> actual = engines[e]->contents();
+
+                if (read == expected_read && engines[e]->size() == expected.size() && actual == expected) continue;
+
+                failed[e] = true;
+                ++failures;
+                std::fprintf(stderr, "%s diverged at step %zu: %s position %u value %d\n", engines[e]->name(), i, operation_names[static_cast<std::size_t>(s.op)], s.position, s.value);
+                if (read != expected_read) std::fprintf(stderr, "  read %d, expected %d\n", read, expected_read);
+                print_contents("expected", expected);
+                print_contents(engines[e]->name(), actual);
+            }
+        }
+
+        for (std::size_t e = 0; e < engines.size(); ++e)
+            std::printf("%-26s %s\n", engines[e]->name(), failed[e] ? "FAILED" : "ok");
+
+        return failures == 0 ? 0 : 1;
+    }
+
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+     * The cost of the two clock reads around a timed step, which is of the same order as
+     * the O(1) operations themselves. The median of many back to back pairs is used.
+     */
+    double clock_overhead_ns() {
+
+        std::vector<std::int64_t> samples(200'001);
+        for (auto& sample : samples) {
+
+            const auto start = clock_type::now();
+            sample = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        return static_cast<double>(samples[samples.size() / 2]);
+    }
+
+    /**
+     * Times each operation type with the clock overhead taken off, and the whole sequence
+     * on a fresh engine without any per-step clock reads for the total.
+     */
+    int time(const std::vector<step>& steps, std::vector<std::unique_ptr<engine>>& engines) {
+
+        const double overhead = clock_overhead_ns();
+
+        std::printf("clock overhead %.1f ns per step, subtracted\n", overhead);
+        std::printf("%-26s", "Mops/s");
+        for (const char* name : operation_names) std::printf(" %10s", name);
+        std::printf(" %10s\n", "total");
+
+        for (auto& e : engines) {
+
+            std::array<std::chrono::nanoseconds, operation_count> spent{};
+            std::array<std::size_t, operation_count> done{};
+            std::uint64_t sink = 0;
+
+            for (const step& s : steps) {
+
+                const auto start = clock_type::now();
+                sink += static_cast<std::uint64_t>(e->apply(s));
+                spent[static_cast<std::size_t>(s.op)] += clock_type::now() - start;
+                ++done[static_cast<std::size_t>(s.op)];
+            }
+
+            auto fresh = std::move(make_engines(e->name()).front());
+            const auto start = clock_type::now();
+            for (const step& s : steps) sink += static_cast<std::uint64_t>(fresh->apply(s));
+            const auto total = clock_type::now() - start;
+
+            std::printf("%-26s", e->name());
+            for (std::size_t op = 0; op < operation_count; ++op) {
+
+                const double net = static_cast<double>(spent[op].count()) - overhead * static_cast<double>(done[op]);
+                if (done[op] == 0) std::printf(" %10s", "-");
+                else if (net <= 0) std::printf(" %10s", "<clock");
+                else std::printf(" %10.2f", static_cast<double>(done[op]) * 1e3 / net);
+            }
+            std::printf(" %10.2f\n", static_cast<double>(steps.size()) * 1e3 / static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(total).count()));
+
+            if (sink == 1) std::printf("\n");
+        }
+
+        return 0;
+    }
+
+    [[noreturn]] void usage(const char* program) {
+
+        std::fprintf(stderr, "usage: %s [--seed N] [--ops N] [--profile", program);
+        for (const auto& p : profiles) std::fprintf(stderr, " %s", p.name);
+        std::fprintf(stderr, "] [--mode verify|time] [--engine NAME]\n");
+        std::exit(2);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::uint64_t seed = 1;
+    std::size_t ops = 100'000;
+    const profile* mix = &profiles[0];
+    std::string mode = "verify";
+    const char* only = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        const char* value = argv[++i];
+
+        if (arg == "--seed") seed = std::strtoull(value, nullptr, 10);
+        else if (arg == "--ops") ops = std::strtoull(value, nullptr, 10);
+        else if (arg == "--mode") mode = value;
+        else if (arg == "--engine") only = value;
+        else if (arg == "--profile") {
+
+            mix = nullptr;
+            for (const auto& p : profiles) if (std::strcmp(p.name, value) == 0) mix = &p;
+            if (mix == nullptr) usage(argv[0]);
+        }
+        else usage(argv[0]);
+    }
+
+    if (mode != "verify" && mode != "time") usage(argv[0]);
+
+    auto engines = make_engines(only);
+    if (engines.empty()) usage(argv[0]);
+
+    std::printf("seed %llu, %zu ops, profile %s, mode %s\n", static_cast<unsigned long long>(seed), ops, mix->name, mode.c_str());
+    const std::vector<step> steps = generate(*mix, seed, ops);
+
+    return mode == "verify" ? verify(steps, engines) : time(steps, engines);
+}
@@ -0,0 +1,141 @@
+// assert.hpp defines its own ASSERT_FALSE, so keep gtest's under the name GTEST_ASSERT_FALSE
+#define GTEST_DONT_DEFINE_ASSERT_FALSE 1
+#include <gtest/gtest.h>
+#include <../include/timer_wheel.hpp>
+
+#include <algorithm>
+#include <vector>
+
+
+
+struct connection_timeout : public mcl::timer_wheel_node<connection_timeout> {
+
+    int id = 0;
+};
+
+class TimerWheelTest : public ::testing::Test {
+
+    protected:
+        void TestBody() override { return; };
+
+        void SetUp() override {
+
+            fired.clear();
+            return;
+        }
+
+        auto recorder() {
+
+            return [this](connection_timeout& timer) { fired.push_back(timer.id); };
+        }
+
+        std::vector<int> fired;
+};
+
+TEST_F(TimerWheelTest, ExpiresInOrder) {
+
+    mcl::timer_wheel<connection_timeout> wheel;
+    connection_timeout a, b, c;
+    a.id = 1;
+    b.id = 2;
+    c.id = 3;
+
+    wheel.schedule(c, 30);
+    wheel.schedule(a, 10);
+    wheel.schedule(b, 20);
+    EXPECT_EQ(wheel.size(), 3);
+
+    EXPECT_EQ(wheel.advance_to(9, recorder()), 0);
+    EXPECT_EQ(wheel.advance_to(10, recorder()), 1);
+    EXPECT_FALSE(a.is_scheduled());
+    EXPECT_EQ(wheel.advance_to(100, recorder()), 2);
+    EXPECT_EQ(fired, (std::vector<int>{1, 2, 3}));
+    EXPECT_TRUE(wheel.empty());
+
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+
+    mcl::timer_wheel<connection_timeout> wheel;
+    connection_timeout a, b;
+    a.id = 1;
+    b.id = 2;
+
+    wheel.schedule(a, 5);
+    wheel.schedule(b, 5);
+    EXPECT_TRUE(wheel.cancel(a));
+    EXPECT_FALSE(wheel.cancel(a));
+    EXPECT_EQ(wheel.size(), 1);
+
+    wheel.advance(10, recorder());
+    EXPECT_EQ(fired, (std::vector<int>{2}));
+
+}
+
+TEST_F(TimerWheelTest, Reschedule) {
+
+    mcl::timer_wheel<connection_timeout> wheel;
+    connection_timeout a;
+    a.id = 1;
+
+    wheel.schedule(a, 5);
+    wheel.schedule(a, 50);
+    EXPECT_EQ(wheel.size(), 1);
+    EXPECT_EQ(wheel.advance_to(49, recorder()), 0);
+    EXPECT_EQ(wheel.advance_to(50, recorder()), 1);
+
+    // Expiries in the past fire on the next tick
+    wheel.schedule(a, 3);
+    EXPECT_EQ(wheel.advance(1, recorder()), 1);
+    EXPECT_EQ(wheel.now(), 51);
+
+}
+
+TEST_F(TimerWheelTest, CascadesThroughLevels) {
+
+    mcl::timer_wheel<connection_timeout, 3, 4> wheel(7);
+    std::vector<connection_timeout> timers(64);
+    std::vector<std::uint64_t> expiries;
+
+    // Spread the expiries across every level and the overflow list
+    for (std::size_t i = 0; i < timers.size(); ++i) {
+
+        timers[i].id = static_cast<int>(i);
+        wheel.schedule(timers[i], 8 + i * i * 37);
+    }
+
+    std::vector<std::uint64_t> when;
+    wheel.advance_to(1'000'000, [&](connection_timeout& timer) {
+
+        EXPECT_EQ(timer.expiry(), wheel.now());
+        when.push_back(wheel.now());
+    });
+
+    EXPECT_EQ(when.size(), timers.size());
+    EXPECT_TRUE(std::is_sorted(when.begin(), when.end()));
+
+}
+
+TEST_F(TimerWheelTest, RescheduleFromCallback) {
+
+    mcl::timer_wheel<connection_timeout> wheel;
+    connection_timeout a;
+    a.id = 1;
+
+    wheel.schedule(a, 1);
+    int count = 0;
+    wheel.advance_to(1000, [&](connection_timeout& timer) {
+
+        if (++count < 10) wheel.schedule(timer, wheel.now() + 100);
+    });
+
+    EXPECT_EQ(count, 10);
+    EXPECT_EQ(a.expiry(), 901);
+
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,291 @@
+// assert.hpp defines its own ASSERT_FALSE, so keep gtest's under the name GTEST_ASSERT_FALSE
+#define GTEST_DONT_DEFINE_ASSERT_FALSE 1
+#include <gtest/gtest.h>
+#include <../include/wait_queue.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+
+// A coroutine that starts eagerly and destroys itself when it finishes.
+struct detached_task {
+
+    struct promise_type {
+
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached_task wait_then_record(mcl::wait_queue& queue, std::vector<int>& log, int id) {
+
+    co_await queue.wait();
+    log.push_back(id);
+}
+
+detached_task wait_twice(mcl::wait_queue& queue, int& count) {
+
+    co_await queue.wait();
+    ++count;
+    co_await queue.wait();
+    ++count;
+}
+
+template<typename Mutex>
+detached_task locked_increment(Mutex& mutex, mcl::wait_queue& gate, int& value, std::vector<int>& log, int id) {
+
+    co_await mutex.lock();
+    log.push_back(id);
+    co_await gate.wait();
+    ++value;
+    mutex.unlock();
+}
+
+detached_task wait_event(mcl::async_event& event, int& count) {
+
+    co_await event.wait();
+    ++count;
+}
+
+detached_task concurrent_waiter(mcl::concurrent_wait_queue& queue, std::atomic<int>& count) {
+
+    co_await queue.wait();
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+detached_task concurrent_increment(mcl::concurrent_async_mutex& mutex, int& value, std::atomic<int>& done) {
+
+    co_await mutex.lock();
+    ++value;
+    mutex.unlock();
+    done.fetch_add(1, std::memory_order_relaxed);
+}
+
+detached_task wait_until(mcl::wait_queue& queue, const bool& ready, int& count) {
+
+    co_await queue.wait([&] { return ready; });
+    ++count;
+}
+
+detached_task concurrent_wait_until(mcl::concurrent_wait_queue& queue, const std::atomic<bool>& ready, std::atomic<bool>& done) {
+
+    co_await queue.wait([&] { return ready.load(std::memory_order_relaxed); });
+    done.store(true, std::memory_order_relaxed);
+}
+
+detached_task lock_and_count(mcl::async_mutex& mutex, int& value) {
+
+    co_await mutex.lock();
+    ++value;
+    mutex.unlock();
+}
+
+class WaitQueueTest : public ::testing::Test {
+
+    protected:
+        void TestBody() override { return; };
+
+        void SetUp() override {
+
+            return;
+        }
+};
+
+TEST_F(WaitQueueTest, NotifyOne) {
+
+    mcl::wait_queue queue;
+    std::vector<int> log;
+
+    wait_then_record(queue, log, 1);
+    wait_then_record(queue, log, 2);
+    EXPECT_TRUE(log.empty());
+    EXPECT_FALSE(queue.empty());
+
+    EXPECT_TRUE(queue.notify_one());
+    EXPECT_EQ(log, (std::vector<int>{1}));
+    EXPECT_TRUE(queue.notify_one());
+    EXPECT_EQ(log, (std::vector<int>{1, 2}));
+    EXPECT_FALSE(queue.notify_one());
+    EXPECT_TRUE(queue.empty());
+
+}
+
+TEST_F(WaitQueueTest, NotifyAllOnlyWakesCurrentWaiters) {
+
+    mcl::wait_queue queue;
+    int count = 0;
+
+    wait_twice(queue, count);
+    wait_twice(queue, count);
+
+    // Both coroutines wait again while being resumed, and must not be woken twice
+    EXPECT_EQ(queue.notify_all(), 2);
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(queue.notify_all(), 2);
+    EXPECT_EQ(count, 4);
+    EXPECT_TRUE(queue.empty());
+
+}
+
+TEST_F(WaitQueueTest, WaitWithPredicate) {
+
+    mcl::wait_queue queue;
+    bool ready = false;
+    int count = 0;
+
+    wait_until(queue, ready, count);
+    EXPECT_EQ(count, 0);
+    EXPECT_FALSE(queue.empty());
+
+    ready = true;
+    EXPECT_TRUE(queue.notify_one());
+    EXPECT_EQ(count, 1);
+
+    // A condition that already holds does not suspend
+    wait_until(queue, ready, count);
+    EXPECT_EQ(count, 2);
+    EXPECT_TRUE(queue.empty());
+
+}
+
+TEST_F(WaitQueueTest, ConcurrentWaitWithPredicate) {
+
+    // The notifier may run before, during or after the waiter parks; it is never lost
+    for (int i = 0; i < 2000; ++i) {
+
+        mcl::concurrent_wait_queue queue;
+        std::atomic<bool> ready{false};
+        std::atomic<bool> done{false};
+
+        std::thread notifier([&] {
+            ready.store(true, std::memory_order_relaxed);
+            queue.notify_one();
+        });
+        concurrent_wait_until(queue, ready, done);
+        notifier.join();
+
+        ASSERT_TRUE(done.load());
+    }
+
+}
+
+TEST_F(WaitQueueTest, AsyncMutex) {
+
+    mcl::async_mutex mutex;
+    mcl::wait_queue gate;
+    std::vector<int> log;
+    int value = 0;
+
+    locked_increment(mutex, gate, value, log, 1);
+    locked_increment(mutex, gate, value, log, 2);
+    locked_increment(mutex, gate, value, log, 3);
+    EXPECT_EQ(log, (std::vector<int>{1}));
+    EXPECT_FALSE(mutex.try_lock());
+
+    // Unlocking hands the mutex to the next waiter in order
+    gate.notify_one();
+    EXPECT_EQ(log, (std::vector<int>{1, 2}));
+    gate.notify_one();
+    gate.notify_one();
+    EXPECT_EQ(log, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(value, 3);
+    EXPECT_TRUE(mutex.try_lock());
+    mutex.unlock();
+
+}
+
+TEST_F(WaitQueueTest, DeepMutexQueue) {
+
+    // Each owner hands the mutex on from its unlock; that must not nest a stack frame per waiter
+    constexpr int waiters = 1'000'000;
+    mcl::async_mutex mutex;
+    int value = 0;
+
+    ASSERT_TRUE(mutex.try_lock());
+    for (int i = 0; i < waiters; ++i)
+        lock_and_count(mutex, value);
+    EXPECT_EQ(value, 0);
+
+    mutex.unlock();
+    EXPECT_EQ(value, waiters);
+    EXPECT_TRUE(mutex.try_lock());
+    mutex.unlock();
+
+}
+
+TEST_F(WaitQueueTest, AsyncEvent) {
+
+    mcl::async_event event;
+    int count = 0;
+
+    wait_event(event, count);
+    wait_event(event, count);
+    EXPECT_EQ(count, 0);
+
+    EXPECT_EQ(event.set(), 2);
+    EXPECT_EQ(count, 2);
+
+    // A set event does not suspend
+    wait_event(event, count);
+    EXPECT_EQ(count, 3);
+
+    event.reset();
+    wait_event(event, count);
+    EXPECT_EQ(count, 3);
+    event.set();
+    EXPECT_EQ(count, 4);
+
+}
+
+TEST_F(WaitQueueTest, ConcurrentNotify) {
+
+    constexpr int waiters = 10000;
+    mcl::concurrent_wait_queue queue;
+    std::atomic<int> count{0};
+
+    for (int i = 0; i < waiters; ++i)
+        concurrent_waiter(queue, count);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&] { while (queue.notify_one()) {} });
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(count.load(), waiters);
+
+}
+
+TEST_F(WaitQueueTest, ConcurrentMutex) {
+
+    constexpr int per_thread = 10000;
+    mcl::concurrent_async_mutex mutex;
+    std::atomic<int> done{0};
+    int value = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&] {
+            for (int i = 0; i < per_thread; ++i)
+                concurrent_increment(mutex, value, done);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(done.load(), 4 * per_thread);
+    EXPECT_EQ(value, 4 * per_thread);
+
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}